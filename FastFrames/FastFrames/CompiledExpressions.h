@@ -0,0 +1,212 @@
+/**
+ * @file CompiledExpressions.h
+ * @brief Registry of ahead-of-time compiled filters and defines and the generator of their source code
+ *
+ */
+
+#pragma once
+
+#include "ROOT/RDataFrame.hxx"
+
+#include <functional>
+#include <map>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Class holding the filters and defines compiled ahead of time.
+ * The string expressions used in a run are recorded together with the types of the columns they use
+ * and can be written as a C++ source file with typed Filter/Define calls.
+ * When the library built from this file is loaded, the expressions are registered here
+ * and used instead of the JIT-compiled strings.
+ *
+ */
+class CompiledExpressions {
+public:
+
+  /**
+   * @brief Type of the function booking a filter
+   *
+   */
+  using FilterFunction = std::function<ROOT::RDF::RNode(ROOT::RDF::RNode)>;
+
+  /**
+   * @brief Type of the function booking a define, the arguments are the node, the column name and a flag for redefine
+   *
+   */
+  using DefineFunction = std::function<ROOT::RDF::RNode(ROOT::RDF::RNode, const std::string&, const bool)>;
+
+  /**
+   * @brief Get the instance of the registry
+   *
+   * @return CompiledExpressions&
+   */
+  static CompiledExpressions& instance();
+
+  /**
+   * @brief Register a compiled filter, called by the generated code
+   *
+   * @param key Key of the expression (see key())
+   * @param function
+   */
+  void addFilter(const std::string& key, FilterFunction function);
+
+  /**
+   * @brief Register a compiled define, called by the generated code
+   *
+   * @param key Key of the expression (see key())
+   * @param function
+   */
+  void addDefine(const std::string& key, DefineFunction function);
+
+  /**
+   * @brief Apply a compiled filter if available
+   *
+   * @param node Input node
+   * @param expression The selection
+   * @param result Filled with the filtered node if the compiled version is available
+   * @return true if the compiled version was used
+   * @return false
+   */
+  bool filter(ROOT::RDF::RNode node, const std::string& expression, ROOT::RDF::RNode* result);
+
+  /**
+   * @brief Apply a compiled define if available
+   *
+   * @param node Input node
+   * @param name Name of the new column
+   * @param expression The expression
+   * @param isRedefine Use Redefine instead of Define
+   * @param result Filled with the new node if the compiled version is available
+   * @return true if the compiled version was used
+   * @return false
+   */
+  bool define(ROOT::RDF::RNode node,
+              const std::string& name,
+              const std::string& expression,
+              const bool isRedefine,
+              ROOT::RDF::RNode* result);
+
+  /**
+   * @brief Read the keys of the expressions that could not be compiled in the previous runs.
+   * These are not considered missing and are not written to the generated code
+   *
+   * @param path Path to the generated code, the keys are stored in the file with ".failed" appended
+   */
+  void readFailedExpressions(const std::string& path);
+
+  /**
+   * @brief Are there expressions that were used but are not compiled yet?
+   *
+   * @return true
+   * @return false
+   */
+  inline bool hasMissingExpressions() const {return m_hasMissing;}
+
+  /**
+   * @brief Write the C++ source with all the expressions used in this run and the expressions already in the file,
+   * so the expressions of runs with other steps or samples are kept.
+   * The source is test-compiled first, if it does not compile the expressions are bisected
+   * and the ones that cannot be compiled are left out and remembered (see readFailedExpressions()).
+   * Nothing is written if even the source without any expression cannot be compiled
+   *
+   * @param path Path to the output file
+   */
+  void writeSource(const std::string& path);
+
+  /**
+   * @brief Key identifying an expression with given column types
+   *
+   * @param expression The expression
+   * @param columns Names and types of the columns used in the expression
+   * @param isFilter Is the expression used as a filter
+   * @return std::string
+   */
+  static std::string key(const std::string& expression,
+                         const std::vector<std::pair<std::string, std::string> >& columns,
+                         const bool isFilter);
+
+private:
+
+  /**
+   * @brief Construct a new Compiled Expressions object
+   *
+   */
+  explicit CompiledExpressions() = default;
+
+  /**
+   * @brief Structure with the information needed to generate the code for one expression
+   *
+   */
+  struct Record {
+    std::string expression;
+    std::vector<std::pair<std::string, std::string> > columns;
+    bool isFilter;
+  };
+
+  /**
+   * @brief Remember the expression for the code generation
+   *
+   * @param key
+   * @param expression
+   * @param columns
+   * @param isFilter
+   * @param isCompiled Is the compiled version available
+   */
+  void record(const std::string& key,
+              const std::string& expression,
+              const std::vector<std::pair<std::string, std::string> >& columns,
+              const bool isFilter,
+              const bool isCompiled);
+
+  /**
+   * @brief Read the expressions from a previously generated source, they are added to the recorded expressions
+   *
+   * @param path Path to the generated source
+   */
+  void readRecords(const std::string& path);
+
+  /**
+   * @brief Write the C++ source for the given expressions
+   *
+   * @param path Path to the output file
+   * @param keys Keys of the expressions to be written
+   */
+  void writeRecords(const std::string& path, const std::vector<std::string>& keys) const;
+
+  /**
+   * @brief Test-compile the expressions (without loading the library)
+   *
+   * @param keys Keys of the expressions, can be empty
+   * @return true if the compilation succeeded
+   * @return false
+   */
+  bool compiles(const std::vector<std::string>& keys) const;
+
+  /**
+   * @brief Find the expressions that cannot be compiled by bisecting expressions that do not compile together.
+   * After maxBisectionDepth halvings, all the expressions of a part that still fails are considered failed
+   *
+   * @param keys Keys of the expressions that do not compile together
+   * @param depth Number of halvings so far
+   * @param failedKeys Filled with the keys of the expressions that cannot be compiled
+   */
+  void findFailingRecords(const std::vector<std::string>& keys,
+                          const std::size_t depth,
+                          std::vector<std::string>* failedKeys) const;
+
+  /**
+   * @brief Maximum number of halvings when looking for the expressions that cannot be compiled,
+   * limits the number of compilations to about 2*maxBisectionDepth per failing expression
+   *
+   */
+  static constexpr std::size_t maxBisectionDepth = 8;
+
+  std::map<std::string, FilterFunction> m_filters;
+  std::map<std::string, DefineFunction> m_defines;
+  std::map<std::string, Record> m_records;
+  std::set<std::string> m_failed;
+  bool m_hasMissing = false;
+};
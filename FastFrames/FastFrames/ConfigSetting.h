@@ -485,6 +485,122 @@ public:
    */
   inline bool convertVectorToRVec() const {return m_convertVectorToRVec;}
 
+  /**
+   * @brief Set the maximum number of sample graphs that are run concurrently
+   *
+   * @param n
+   */
+  inline void setMaxConcurrentGraphs(const int n) {m_maxConcurrentGraphs = n;}
+
+  /**
+   * @brief Get the maximum number of sample graphs that are run concurrently
+   *
+   * @return int
+   */
+  inline int maxConcurrentGraphs() const {return m_maxConcurrentGraphs;}
+
+  /**
+   * @brief Set the flag to fill the 1D histograms for all systematics with one action per region and variable
+   *
+   * @param flag
+   */
+  inline void setVectoriseSystematicHistograms(const bool flag) {m_vectoriseSystematicHistograms = flag;}
+
+  /**
+   * @brief Should the 1D histograms for all systematics be filled with one action per region and variable?
+   *
+   * @return true
+   * @return false
+   */
+  inline bool vectoriseSystematicHistograms() const {return m_vectoriseSystematicHistograms;}
+
+  /**
+   * @brief Set the path to the directory with the cached compiled string expressions
+   *
+   * @param directory
+   */
+  inline void setJitCacheDirectory(const std::string& directory) {m_jitCacheDirectory = directory;}
+
+  /**
+   * @brief Get the path to the directory with the cached compiled string expressions (empty = no caching)
+   *
+   * @return const std::string&
+   */
+  inline const std::string& jitCacheDirectory() const {return m_jitCacheDirectory;}
+
+  /**
+   * @brief Set the path to the generated C++ file with the compiled expressions
+   *
+   * @param path
+   */
+  inline void setCompiledCodePath(const std::string& path) {m_compiledCodePath = path;}
+
+  /**
+   * @brief Get the path to the generated C++ file with the compiled expressions (empty = not used)
+   *
+   * @return const std::string&
+   */
+  inline const std::string& compiledCodePath() const {return m_compiledCodePath;}
+
+  /**
+   * @brief Set the format of the output ntuples, "ttree" or "rntuple"
+   *
+   * @param format
+   */
+  inline void setNtupleFormat(const std::string& format) {m_ntupleFormat = format;}
+
+  /**
+   * @brief Get the format of the output ntuples, "ttree" or "rntuple"
+   *
+   * @return const std::string&
+   */
+  inline const std::string& ntupleFormat() const {return m_ntupleFormat;}
+
+  /**
+   * @brief Set the flag to cache the reco-truth index next to the input files
+   *
+   * @param flag
+   */
+  inline void setCacheTruthIndex(const bool flag) {m_cacheTruthIndex = flag;}
+
+  /**
+   * @brief Cache the reco-truth index next to the input files?
+   *
+   * @return true
+   * @return false
+   */
+  inline bool cacheTruthIndex() const {return m_cacheTruthIndex;}
+
+  /**
+   * @brief Set the flag to split the jobs by the entry ranges instead of whole files
+   *
+   * @param flag
+   */
+  inline void setSplitJobsByEntries(const bool flag) {m_splitJobsByEntries = flag;}
+
+  /**
+   * @brief Split the jobs by the entry ranges instead of whole files?
+   *
+   * @return true
+   * @return false
+   */
+  inline bool splitJobsByEntries() const {return m_splitJobsByEntries;}
+
+  /**
+   * @brief Set the flag to evaluate all region selections of a systematic in one bitmask column
+   *
+   * @param flag
+   */
+  inline void setRegionBitmask(const bool flag) {m_regionBitmask = flag;}
+
+  /**
+   * @brief Evaluate all region selections of a systematic in one bitmask column?
+   *
+   * @return true
+   * @return false
+   */
+  inline bool regionBitmask() const {return m_regionBitmask;}
+
 private:
   std::string m_outputPathHistograms;
   std::string m_outputPathNtuples;
@@ -517,4 +633,12 @@ private:
   int m_ntupleAutoFlush = 0;
   bool m_splitProcessingPerUniqueSample = false;
   bool m_convertVectorToRVec = false;
+  int m_maxConcurrentGraphs = 1;
+  bool m_vectoriseSystematicHistograms = false;
+  std::string m_jitCacheDirectory = "";
+  std::string m_compiledCodePath = "";
+  std::string m_ntupleFormat = "ttree";
+  bool m_cacheTruthIndex = false;
+  bool m_splitJobsByEntries = true;
+  bool m_regionBitmask = false;
 };
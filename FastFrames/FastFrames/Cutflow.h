@@ -57,8 +57,22 @@ public:
    */
   inline const std::vector<std::pair<std::string, std::string> >& selections() const {return m_selections;}
 
+  /**
+   * @brief Set if the cutflow is produced for all systematic variations
+   * @param systematics
+   */
+  inline void setSystematics(const bool systematics) {m_systematics = systematics;}
+
+  /**
+   * @brief Is the cutflow produced for all systematic variations
+   * @return true
+   * @return false
+   */
+  inline bool systematics() const {return m_systematics;}
+
 private:
 
   std::string m_name;
   std::vector<std::pair<std::string, std::string> > m_selections;
+  bool m_systematics;
 };
@@ -8,6 +8,7 @@
 #include "ROOT/RResultPtr.hxx"
 
 #include "TH1D.h"
+#include "TH2D.h"
 
 #include <memory>
 #include <string>
@@ -92,6 +93,30 @@ public:
     m_titles.emplace_back(title);
   }
 
+  /**
+   * @brief Add the booked sums of all steps from a single cutflow action
+   *
+   * @param sums Sums of weights of all steps (of all systematics) followed by the sums of squared weights
+   * @param titles Titles of the steps
+   * @param systematicNames Names of the systematic variations, the first one is the nominal. Empty for the nominal-only cutflow
+   */
+  void addBookedSums(const ROOT::RDF::RResultPtr<std::vector<double> >& sums,
+                     const std::vector<std::string>& titles,
+                     const std::vector<std::string>& systematicNames = {}) {
+
+    m_bookedSums = sums;
+    m_titles.insert(m_titles.end(), titles.begin(), titles.end());
+    m_systematicNames = systematicNames;
+  }
+
+  /**
+   * @brief Is the cutflow produced also for the systematic variations
+   *
+   * @return true
+   * @return false
+   */
+  inline bool hasSystematics() const {return !m_systematicNames.empty();}
+
   /**
    * @brief Copy the values for cutflows from result pointers to values
    *
@@ -106,6 +131,13 @@ public:
    */
   void mergeValues(CutflowContainer& other);
 
+  /**
+   * @brief Add the values of a container that already has its values copied
+   *
+   * @param other
+   */
+  void mergeCopiedValues(const CutflowContainer& other);
+
   /**
    * @brief Turn the values into histogram
    *
@@ -113,6 +145,13 @@ public:
    */
   std::unique_ptr<TH1D> cutflowHisto() const;
 
+  /**
+   * @brief Turn the values of all systematic variations into a 2D histogram (step vs systematic)
+   *
+   * @return std::unique_ptr<TH2D>
+   */
+  std::unique_ptr<TH2D> systematicCutflowHisto() const;
+
   /**
    * @brief Executes the event loop and gets the cutflow histo
    *
@@ -121,10 +160,21 @@ public:
   std::unique_ptr<TH1D> cutflowHistoExecute();
 
 private:
+
+  /**
+   * @brief Get the booked values, triggers the event loop if needed
+   *
+   * @param yields
+   * @param errors Squared errors
+   */
+  void bookedValues(std::vector<double>* yields, std::vector<double>* errors);
+
   std::string m_name;
   std::vector<ROOT::RDF::RResultPtr<double> > m_bookedYields;
   std::vector<ROOT::RDF::RResultPtr<double> > m_bookedYieldErrors;
+  ROOT::RDF::RResultPtr<std::vector<double> > m_bookedSums;
   std::vector<std::string> m_titles;
+  std::vector<std::string> m_systematicNames;
   std::vector<double> m_yields;
   std::vector<double> m_yieldErrors;
 };
@@ -0,0 +1,127 @@
+/**
+ * @file CutflowHelper.h
+ * @brief Custom RDataFrame action accumulating all steps of a cutflow at once
+ *
+ */
+
+#pragma once
+
+#include "ROOT/RDF/RActionImpl.hxx"
+#include "ROOT/RVec.hxx"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+class TTreeReader;
+
+/**
+ * @brief Custom RDataFrame action that accumulates the sum of weights and the sum of squared weights
+ * of all steps of a cutflow in a single call.
+ * The steps are sequential, so the result of the selections of one event is given as the number of
+ * consecutive steps passed by the event (the first step, "Initial", is always passed).
+ * This replaces a chain of filters and two Sum actions per step.
+ * Several variations (systematics) of the cutflow, each with its own selections and weight, can be accumulated in the same action.
+ * The result contains the sums of weights of all steps of all variations (the steps of one variation are contiguous)
+ * followed by the sums of squared weights in the same order.
+ *
+ */
+class CutflowHelper : public ROOT::Detail::RDF::RActionImpl<CutflowHelper> {
+public:
+
+  /**
+   * @brief Type of the result
+   *
+   */
+  using Result_t = std::vector<double>;
+
+  /**
+   * @brief Construct a new Cutflow Helper object
+   *
+   * @param nSteps Number of the cutflow steps
+   * @param nSlots Number of the processing slots
+   * @param nVariations Number of the variations of the cutflow
+   */
+  explicit CutflowHelper(const std::size_t nSteps,
+                         const unsigned int nSlots,
+                         const std::size_t nVariations = 1);
+
+  /**
+   * @brief Deleted copy constructor
+   *
+   */
+  CutflowHelper(const CutflowHelper&) = delete;
+
+  /**
+   * @brief Default move constructor
+   *
+   */
+  CutflowHelper(CutflowHelper&&) = default;
+
+  /**
+   * @brief Destroy the Cutflow Helper object
+   *
+   */
+  ~CutflowHelper() = default;
+
+  /**
+   * @brief Get the pointer to the result
+   *
+   * @return std::shared_ptr<Result_t>
+   */
+  std::shared_ptr<Result_t> GetResultPtr() const {return m_result;}
+
+  /**
+   * @brief Called before the event loop
+   *
+   */
+  void Initialize() {}
+
+  /**
+   * @brief Called at the beginning of each task
+   *
+   */
+  void InitTask(TTreeReader*, unsigned int) {}
+
+  /**
+   * @brief Accumulate the weight for all the steps passed by one event
+   *
+   * @param slot Processing slot
+   * @param nPassed Number of consecutive steps passed by the event
+   * @param weight Weight of the event
+   */
+  void Exec(unsigned int slot, const int nPassed, const double weight);
+
+  /**
+   * @brief Accumulate the weights for all the steps passed by one event for all the variations
+   *
+   * @param slot Processing slot
+   * @param nPassed Number of consecutive steps passed by the event, one per variation
+   * @param weights Weights of the event, one per variation
+   */
+  void Exec(unsigned int slot,
+            const ROOT::VecOps::RVec<int>& nPassed,
+            const ROOT::VecOps::RVec<double>& weights);
+
+  /**
+   * @brief Sum the values from the processing slots
+   *
+   */
+  void Finalize();
+
+  /**
+   * @brief Get the name of the action
+   *
+   * @return std::string
+   */
+  std::string GetActionName() const {return "Cutflow";}
+
+private:
+  std::shared_ptr<Result_t> m_result;
+  std::size_t m_nSteps;
+  std::size_t m_nVariations;
+  // distance between the values of two slots, padded to avoid false sharing
+  std::size_t m_slotStride;
+  // sums of weights followed by the sums of squared weights, for all slots
+  std::vector<double> m_perSlotSums;
+};
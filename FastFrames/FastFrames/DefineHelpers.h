@@ -7,6 +7,7 @@
 
 #include "Math/Vector4D.h"
 
+#include <type_traits>
 #include <vector>
 
 #include "ROOT/RVec.hxx"
@@ -450,4 +451,55 @@ namespace DefineHelpers {
                                                const std::vector<char>& selection1,
                                                const std::vector<char>& selection2);
 
+  /**
+   * @brief Number of values of a packed input: 1 for a number, the size for a vector
+   *
+   * @tparam T
+   * @param input
+   * @return std::size_t
+   */
+  template<typename T>
+  std::size_t packedSize(const T& input) {
+    if constexpr (std::is_arithmetic_v<T>) {
+      return 1;
+    } else {
+      return input.size();
+    }
+  }
+
+  /**
+   * @brief Append a number or all elements of a vector to the packed vector
+   *
+   * @tparam T
+   * @param packed The packed vector
+   * @param input
+   */
+  template<typename T>
+  void appendPacked(ROOT::VecOps::RVec<float>& packed, const T& input) {
+    if constexpr (std::is_arithmetic_v<T>) {
+      packed.emplace_back(static_cast<float>(input));
+    } else {
+      for (const auto& element : input) {
+        packed.emplace_back(static_cast<float>(element));
+      }
+    }
+  }
+
+  /**
+   * @brief Pack any number of numbers and vectors into one contiguous vector of floats,
+   * e.g. the inputs of an ML model
+   *
+   * @tparam T
+   * @param inputs
+   * @return ROOT::VecOps::RVec<float>
+   */
+  template<typename... T>
+  ROOT::VecOps::RVec<float> packFloats(const T&... inputs) {
+    ROOT::VecOps::RVec<float> result;
+    result.reserve((DefineHelpers::packedSize(inputs) + ... + 0));
+    (DefineHelpers::appendPacked(result, inputs), ...);
+
+    return result;
+  }
+
 };
@@ -12,6 +12,7 @@
 
 #include "ROOT/RResultPtr.hxx"
 
+#include <map>
 #include <memory>
 #include <vector>
 #include <string>
@@ -90,6 +91,26 @@ public:
    */
   inline ROOT::RDF::RResultPtr<TH1D> histo() const {return m_histo;}
 
+  /**
+   * @brief Set the histogram from a packed result of a SystematicHisto1DHelper
+   * that fills histograms for many systematic variations at once
+   *
+   * @param h The packed histograms
+   * @param index Index of this histogram in the packed histograms
+   */
+  void setPackedHisto(const ROOT::RDF::RResultPtr<std::vector<TH1D> >& h, const std::size_t index) {
+    m_packedHistos = h;
+    m_packedIndex = index;
+  }
+
+  /**
+   * @brief Get the pointer to the histogram, regardless if it is booked directly or as a packed histogram
+   * This triggers the event loop!
+   *
+   * @return const TH1D*
+   */
+  const TH1D* histoPtr() const;
+
   /**
    * @brief Get the unique ptr histogram
    * 
@@ -104,6 +125,13 @@ public:
    */
   void mergeHisto(ROOT::RDF::RResultPtr<TH1D> h);
 
+  /**
+   * @brief Merge histograms (add them) from an already copied histogram
+   *
+   * @param h Other histogram
+   */
+  void mergeHisto(const std::unique_ptr<TH1D>& h);
+
   /**
    * @brief Copy the RResultsPtr to the unique ptr 
    * 
@@ -112,9 +140,25 @@ public:
    */
   void copyHisto(ROOT::RDF::RResultPtr<TH1D> h);
 
+  /**
+   * @brief Copy the histogram to the unique ptr
+   *
+   * @param h
+   */
+  void copyHisto(const TH1D* h);
+
+  /**
+   * @brief Merge histograms (add them)
+   *
+   * @param h Other histogram
+   */
+  void mergeHisto(const TH1D* h);
+
 private:
   std::string m_name;
   ROOT::RDF::RResultPtr<TH1D> m_histo;
+  ROOT::RDF::RResultPtr<std::vector<TH1D> > m_packedHistos;
+  std::size_t m_packedIndex = 0;
   std::unique_ptr<TH1D> m_histoUniquePtr;
 
 };
@@ -207,6 +251,13 @@ public:
    */
   void mergeHisto(ROOT::RDF::RResultPtr<TH2D> h);
 
+  /**
+   * @brief Merge histograms (add them) from an already copied histogram
+   *
+   * @param h Other histogram
+   */
+  void mergeHisto(const std::unique_ptr<TH2D>& h);
+
   /**
    * @brief Copy the RResultsPtr to the unique ptr 
    * 
@@ -308,6 +359,13 @@ public:
    */
   void mergeHisto(ROOT::RDF::RResultPtr<TH3D> h);
 
+  /**
+   * @brief Merge histograms (add them) from an already copied histogram
+   *
+   * @param h Other histogram
+   */
+  void mergeHisto(const std::unique_ptr<TH3D>& h);
+
   /**
    * @brief Copy the RResultsPtr to the unique ptr 
    * 
@@ -529,9 +587,85 @@ public:
    */
   SystematicHisto copy() const;
 
+  /**
+   * @brief Merge (add) SystematicHistos that have already been copied
+   * from the RResultPtrs (see copy())
+   *
+   * @param histo
+   */
+  void mergeCopy(const SystematicHisto& histo);
+
 private:
 
+  /**
+   * @brief Check if the other SystematicHisto has the same structure
+   * Throws an exception if not
+   *
+   * @param other
+   */
+  void checkCompatibility(const SystematicHisto& other) const;
+
   std::string m_name;
   std::vector<RegionHisto> m_regions;
 
 };
+
+/**
+ * @brief Class holding 1D histograms that are filled for many systematics at once
+ * (packed histograms, see SystematicHisto1DHelper) per region and variable
+ *
+ */
+class PackedHistoContainer {
+public:
+
+  /**
+   * @brief Construct a new Packed Histo Container object
+   *
+   */
+  explicit PackedHistoContainer() = default;
+
+  /**
+   * @brief Destroy the Packed Histo Container object
+   *
+   */
+  ~PackedHistoContainer() = default;
+
+  /**
+   * @brief Add packed histograms for a given region and variable
+   *
+   * @param region Name of the region
+   * @param variable Name of the variable
+   * @param histos The booked packed histograms
+   * @param systematics Names of the systematics, in the same order as the packed histograms
+   */
+  void addHistos(const std::string& region,
+                 const std::string& variable,
+                 const ROOT::RDF::RResultPtr<std::vector<TH1D> >& histos,
+                 const std::vector<std::string>& systematics);
+
+  /**
+   * @brief Set the packed histogram to the VariableHisto (based on its name) if it is available
+   *
+   * @param histo VariableHisto to be set
+   * @param region Name of the region
+   * @param systematic Name of the systematic
+   * @return true if the histogram was found
+   * @return false
+   */
+  bool setPackedHisto(VariableHisto* histo,
+                      const std::string& region,
+                      const std::string& systematic) const;
+
+  /**
+   * @brief Are there any packed histograms?
+   *
+   * @return true
+   * @return false
+   */
+  inline bool empty() const {return m_histos.empty();}
+
+private:
+  std::map<std::pair<std::string, std::string>,
+           std::vector<std::pair<ROOT::RDF::RResultPtr<std::vector<TH1D> >, std::vector<std::string> > > > m_histos;
+};
+
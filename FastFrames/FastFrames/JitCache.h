@@ -0,0 +1,239 @@
+/**
+ * @file JitCache.h
+ * @brief On-disk cache of compiled string expressions used in RDataFrame
+ *
+ */
+
+#pragma once
+
+#include "ROOT/RDataFrame.hxx"
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Class that stores the string expressions (filters and defines) as compiled functions in a directory.
+ * The expressions used in a run are written as C++ functions taking the used columns as arguments
+ * and compiled with ACLiC at the end of the run.
+ * In the following runs, the libraries are loaded and register a typed Filter/Define of each function,
+ * so the expressions are booked without the interpreter.
+ * The functions are identified by the expression, the types of the columns and the ROOT version.
+ *
+ */
+class JitCache {
+public:
+
+  /**
+   * @brief Type of the function booking a filter
+   *
+   */
+  using FilterFunction = std::function<ROOT::RDF::RNode(ROOT::RDF::RNode)>;
+
+  /**
+   * @brief Type of the function booking a define, the arguments are the node, the column name and a flag for redefine
+   *
+   */
+  using DefineFunction = std::function<ROOT::RDF::RNode(ROOT::RDF::RNode, const std::string&, const bool)>;
+
+  /**
+   * @brief Construct a new Jit Cache object
+   *
+   * @param directory Path to the directory with the cache
+   */
+  explicit JitCache(const std::string& directory);
+
+  /**
+   * @brief Destroy the Jit Cache object
+   *
+   */
+  ~JitCache() = default;
+
+  /**
+   * @brief Load the compiled functions from the cache directory
+   *
+   */
+  void load();
+
+  /**
+   * @brief Apply the cached filter if available
+   *
+   * @param node Input node
+   * @param expression The selection
+   * @param result Filled with the filtered node if the compiled function is available
+   * @return true if the compiled function was used
+   * @return false
+   */
+  bool filter(ROOT::RDF::RNode node,
+              const std::string& expression,
+              ROOT::RDF::RNode* result) const;
+
+  /**
+   * @brief Apply the cached define if available
+   *
+   * @param node Input node
+   * @param name Name of the new column
+   * @param expression The expression
+   * @param isRedefine Use Redefine instead of Define
+   * @param result Filled with the new node if the compiled function is available
+   * @return true if the compiled function was used
+   * @return false
+   */
+  bool define(ROOT::RDF::RNode node,
+              const std::string& name,
+              const std::string& expression,
+              const bool isRedefine,
+              ROOT::RDF::RNode* result) const;
+
+  /**
+   * @brief Add an expression that is not in the cache yet. It will be compiled when calling write()
+   *
+   * @param node The node where the expression was used (before the expression was added)
+   * @param expression The original expression
+   * @param returnType The type returned by the expression
+   * @param isFilter Is the expression used as a filter
+   */
+  void addExpression(ROOT::RDF::RNode node,
+                     const std::string& expression,
+                     const std::string& returnType,
+                     const bool isFilter);
+
+  /**
+   * @brief Write the new expressions to the cache directory and compile them
+   *
+   */
+  void write();
+
+  /**
+   * @brief Register a compiled filter, called by the cache libraries when they are loaded
+   *
+   * @param name Name of the compiled function
+   * @param function
+   * @return true
+   */
+  static bool registerFilter(const std::string& name, FilterFunction function);
+
+  /**
+   * @brief Register a compiled define, called by the cache libraries when they are loaded
+   *
+   * @param name Name of the compiled function
+   * @param function
+   * @return true
+   */
+  static bool registerDefine(const std::string& name, DefineFunction function);
+
+  /**
+   * @brief Find the columns used in an expression
+   *
+   * @param node The node
+   * @param expression The expression
+   * @param columns Filled with the names and the types of the columns in order of their appearance
+   * @return true if the expression can be compiled as a function of the columns
+   * @return false
+   */
+  static bool usedColumns(ROOT::RDF::RNode node,
+                          const std::string& expression,
+                          std::vector<std::pair<std::string, std::string> >* columns);
+
+  /**
+   * @brief 64 bit FNV-1a hash (stable between runs)
+   *
+   * @param text
+   * @return std::uint64_t
+   */
+  static std::uint64_t hash(const std::string& text);
+
+private:
+
+  /**
+   * @brief Compiled filters registered by the loaded cache libraries, indexed by the function name
+   *
+   * @return std::map<std::string, FilterFunction>&
+   */
+  static std::map<std::string, FilterFunction>& filters();
+
+  /**
+   * @brief Compiled defines registered by the loaded cache libraries, indexed by the function name
+   *
+   * @return std::map<std::string, DefineFunction>&
+   */
+  static std::map<std::string, DefineFunction>& defines();
+
+  /**
+   * @brief Name of the compiled function for a given expression
+   *
+   * @param expression The expression
+   * @param columns Names and types of the used columns
+   * @param isFilter Is the expression used as a filter
+   * @return std::string
+   */
+  std::string functionName(const std::string& expression,
+                           const std::vector<std::pair<std::string, std::string> >& columns,
+                           const bool isFilter) const;
+
+  /**
+   * @brief Find the functions that cannot be compiled by bisecting functions that do not compile together,
+   * the other functions are compiled into the cache.
+   * After maxBisectionDepth halvings, all the functions of a part that still fails are considered failed
+   *
+   * @param functions Names and sources of the functions that do not compile together
+   * @param depth Number of halvings so far
+   * @param failedNames Filled with the names of the functions that cannot be compiled
+   */
+  void compileFunctions(const std::vector<std::pair<std::string, std::string> >& functions,
+                        const std::size_t depth,
+                        std::vector<std::string>* failedNames) const;
+
+  /**
+   * @brief Write the functions into one file in the cache directory and compile it.
+   * The file is written under a temporary name and renamed when complete, as the directory can be shared by several jobs.
+   * The file is removed if the compilation fails
+   *
+   * @param functions Names and sources of the functions
+   * @return true if the compilation succeeded
+   * @return false
+   */
+  bool writeAndCompile(const std::vector<std::pair<std::string, std::string> >& functions) const;
+
+  /**
+   * @brief Test-compile a cache file without any function in the temporary directory (without loading the library).
+   * Used to tell failing functions from problems with the environment (e.g. missing headers)
+   *
+   * @return true if the compilation succeeded
+   * @return false
+   */
+  bool compilesWithoutFunctions() const;
+
+  /**
+   * @brief Write the source of a cache file
+   *
+   * @param path Path to the file
+   * @param functions Names and sources of the functions
+   * @return true if the file was written
+   * @return false
+   */
+  bool writeFile(const std::string& path,
+                 const std::vector<std::pair<std::string, std::string> >& functions) const;
+
+  /**
+   * @brief Prefix of the cache files for the current ROOT version
+   *
+   * @return std::string
+   */
+  std::string filePrefix() const;
+
+  /**
+   * @brief Maximum number of halvings when looking for the functions that cannot be compiled,
+   * limits the number of compilations to about 2*maxBisectionDepth per failing function
+   *
+   */
+  static constexpr std::size_t maxBisectionDepth = 8;
+
+  std::string m_directory;
+  std::set<std::string> m_failed;
+  std::map<std::string, std::string> m_newFunctions;
+};
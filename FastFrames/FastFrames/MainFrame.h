@@ -9,20 +9,24 @@
 #include "FastFrames/ConfigSetting.h"
 #include "FastFrames/CutflowContainer.h"
 #include "FastFrames/HistoContainer.h"
+#include "FastFrames/JitCache.h"
 #include "FastFrames/MetadataManager.h"
 #include "FastFrames/StringOperations.h"
 #include "FastFrames/SystematicReplacer.h"
 #include "FastFrames/Truth.h"
+#include "FastFrames/Utils.h"
+#include "FastFrames/WeightExpression.h"
 
 #include "ROOT/RDataFrame.hxx"
 #include "TClass.h"
 
+#include <map>
 #include <memory>
 #include <string>
 #include <tuple>
 
 class Variable;
-class TTreeIndex;
+class TVirtualIndex;
 
 /**
  * @brief Main class that does all the hard work
@@ -358,7 +362,7 @@ private:
    *
    * @param sample
    * @param uniqueSampleID
-   * @return std::tuple<std::vector<SystematicHisto>, std::vector<VariableHisto>, std::vector<CutflowContainer>, ROOT::RDF::RNode, std::vector<std::pair<TChain*, TTreeIndex*> > >
+   * @return std::tuple<std::vector<SystematicHisto>, std::vector<VariableHisto>, std::vector<CutflowContainer>, ROOT::RDF::RNode, std::vector<std::pair<TChain*, TVirtualIndex*> > >
    * The histograms, truth histograms, the main RDF node for logging, and truth tchain pointers for memory management
    */
   std::tuple<std::vector<SystematicHisto>,
@@ -366,7 +370,7 @@ private:
              std::vector<CutflowContainer>,
              ROOT::RDF::RNode,
              std::unique_ptr<TChain>,
-             std::vector<std::pair<std::unique_ptr<TChain>, std::unique_ptr<TTreeIndex> > > > processUniqueSample(const std::shared_ptr<Sample>& sample,
+             std::vector<std::pair<std::unique_ptr<TChain>, std::unique_ptr<TVirtualIndex> > > > processUniqueSample(const std::shared_ptr<Sample>& sample,
                                                                                                                   const UniqueSampleID& uniqueSampleID);
 
   /**
@@ -381,6 +385,30 @@ private:
              std::vector<VariableHisto>,
              std::vector<CutflowContainer> > processHistogramsSplitPerUniqueSample(const std::shared_ptr<Sample>& sample);
 
+  /**
+   * @brief Merge the copied histograms and cutflows of several unique samples
+   * The merging is done pairwise in a reduction tree, each level is merged in parallel.
+   * Only the first element of the input vector is kept at the end
+   *
+   * @param products Systematic histograms, truth histograms and cutflows for each unique sample
+   */
+  void reduceHistoProducts(std::vector<std::tuple<std::vector<SystematicHisto>,
+                                                  std::vector<VariableHisto>,
+                                                  std::vector<CutflowContainer> > >& products) const;
+
+  /**
+   * @brief Add the copied histograms and cutflows of one unique sample to another one
+   *
+   * @param target Where the results are added
+   * @param other Results to be added
+   */
+  void mergeHistoProducts(std::tuple<std::vector<SystematicHisto>,
+                                     std::vector<VariableHisto>,
+                                     std::vector<CutflowContainer> >& target,
+                          const std::tuple<std::vector<SystematicHisto>,
+                                           std::vector<VariableHisto>,
+                                           std::vector<CutflowContainer> >& other) const;
+
   /**
    * @brief Process histograms for a single sample in one go
    *
@@ -393,6 +421,26 @@ private:
              std::vector<CutflowContainer>,
              ROOT::RDF::RNode> processSampleWithAllUniqueSamples(const std::shared_ptr<Sample>& sample);
 
+  /**
+   * @brief Get the number of computation graphs that can run concurrently.
+   * Returns 1 when the simple ONNX inference is used as its per-slot buffers cannot be shared between graphs
+   *
+   * @return std::size_t
+   */
+  std::size_t maxConcurrentGraphs() const;
+
+  /**
+   * @brief Run the event loops of all booked samples concurrently (using RunGraphs)
+   * and write the histograms to the output files afterwards.
+   * The input vector is cleared at the end so that the RDF graphs can be released
+   *
+   * @param bookedSamples Samples with their booked histograms, cutflows and the main RDF node
+   */
+  void runBookedSamplesAndWrite(std::vector<std::tuple<std::shared_ptr<Sample>,
+                                                       std::vector<SystematicHisto>,
+                                                       std::vector<CutflowContainer>,
+                                                       ROOT::RDF::RNode> >& bookedSamples);
+
   /**
    * @brief Main processing function for ntuples
    *
@@ -418,9 +466,10 @@ private:
    * This is needed for apply filters on ntuples
    *
    * @param sample
+   * @param nominalSelection The nominal selection
    * @return std::string
    */
-  std::string systematicOrFilter(const std::shared_ptr<Sample>& sample) const;
+  std::string systematicOrFilter(const std::shared_ptr<Sample>& sample, const std::string& nominalSelection) const;
 
   /**
    * @brief Get name of a variable after applying the systematic replacements
@@ -443,6 +492,8 @@ private:
 
   /**
    * @brief apply RDF filters (selections)
+   * The selections are split into the terms of their conjunction and the filters form a prefix tree,
+   * so the terms shared by the beginning of the selections of several regions (and systematics) are evaluated once per event
    *
    * @param mainNode current ROOT node
    * @param sample current Sample
@@ -453,6 +504,21 @@ private:
                                                            const std::shared_ptr<Sample>& sample,
                                                            const UniqueSampleID& id);
 
+  /**
+   * @brief apply RDF filters (selections) using bitmask columns.
+   * The selections of all regions of a systematic are evaluated in one column with one bit per region
+   * (one 64-bit column per 64 regions), systematics with identical selections share the columns.
+   * The filter of a region only tests its bit
+   *
+   * @param mainNode current ROOT node
+   * @param sample current Sample
+   * @param id unique sample ID
+   * @return std::vector<std::vector<ROOT::RDF::RNode> > Filter stored per region, per systematic
+   */
+  std::vector<std::vector<ROOT::RDF::RNode> > applyBitmaskFilters(ROOT::RDF::RNode mainNode,
+                                                                  const std::shared_ptr<Sample>& sample,
+                                                                  const UniqueSampleID& id);
+
   /**
    * @brief Add columns representing the systematic event weights
    *
@@ -483,6 +549,14 @@ private:
                                          const std::shared_ptr<Systematic>& systematic,
                                          const UniqueSampleID& id);
 
+  /**
+   * @brief Get the parsed weight formula, each formula is parsed only once
+   *
+   * @param formula The formula
+   * @return const WeightExpression&
+   */
+  const WeightExpression& weightExpression(const std::string& formula);
+
   /**
    * @brief Adds ROOT::Math::PtEtaPhiEVector for provided objects to RDF
    *
@@ -506,10 +580,31 @@ private:
    *
    * @param filters List of nodes, each node represents per region, per systematic filter
    * @param sample current sample
+   * @param packedHistos 1D histograms already booked for several systematics at once (see bookPackedHistos1D)
    * @return std::vector<SystematicHisto> container of the histograms
    */
   std::vector<SystematicHisto> processHistograms(std::vector<std::vector<ROOT::RDF::RNode> >& filters,
-                                                 const std::shared_ptr<Sample>& sample);
+                                                 const std::shared_ptr<Sample>& sample,
+                                                 const PackedHistoContainer& packedHistos = PackedHistoContainer());
+
+  /**
+   * @brief Book 1D histograms for many systematics of a region and variable in one action (SystematicHisto1DHelper).
+   * Systematics that only change the weight (same selection and variable as nominal) are filled on the nominal filter
+   * with the nominal value and one packed weight column.
+   * For the other systematics, the values, weights and selection flags are packed into one column each
+   * and filled on a node passing at least one of the systematic selections.
+   * Only variables with a known scalar type that are not nominal only are booked this way.
+   *
+   * @param mainNode Node before the region filters
+   * @param filters Per systematic, per region filters (see applyFilters)
+   * @param sample Sample
+   * @param id UniqueSampleID
+   * @return PackedHistoContainer Booked histograms and the names of the corresponding systematics
+   */
+  PackedHistoContainer bookPackedHistos1D(ROOT::RDF::RNode mainNode,
+                                          const std::vector<std::vector<ROOT::RDF::RNode> >& filters,
+                                          const std::shared_ptr<Sample>& sample,
+                                          const UniqueSampleID& id);
 
   /**
    * @brief Define 1D histograms with variables and systematics
@@ -519,12 +614,14 @@ private:
    * @param sample Sample
    * @param region Region
    * @param systematic Systematic
+   * @param packedHistos 1D histograms booked for several systematics at once
    */
   void processHistograms1D(RegionHisto* regionHisto,
                            const ROOT::RDF::RNode& node,
                            const std::shared_ptr<Sample>& sample,
                            const std::shared_ptr<Region>& region,
-                           const std::shared_ptr<Systematic>& systematic) const;
+                           const std::shared_ptr<Systematic>& systematic,
+                           const PackedHistoContainer& packedHistos) const;
 
   /**
    * @brief Define 2D histograms with variables and systematics
@@ -621,9 +718,9 @@ private:
    * @param chain The reco chain
    * @param sample Current Sample
    * @param filePaths Paths to the files
-   * @result std::vector<std::pair<std::unique_ptr<TChain>, std::unique_ptr<TTreeIndex> > > the pointers for deleting
+   * @result std::vector<std::pair<std::unique_ptr<TChain>, std::unique_ptr<TVirtualIndex> > > the pointers for deleting
    */
-  std::vector<std::pair<std::unique_ptr<TChain>, std::unique_ptr<TTreeIndex> > > connectTruthTrees(std::unique_ptr<TChain>& chain,
+  std::vector<std::pair<std::unique_ptr<TChain>, std::unique_ptr<TVirtualIndex> > > connectTruthTrees(std::unique_ptr<TChain>& chain,
                                                                                                    const std::shared_ptr<Sample>& sample,
                                                                                                    const std::vector<std::string>& filePaths);
 
@@ -633,11 +730,13 @@ private:
    * @param filePaths Paths to the input files
    * @param sample Current sample
    * @param id current UniqueSampleID
+   * @param rejectAllEvents Book the histograms, but reject all events (used for jobs that do not process any file from its first entry)
    * @return std::vector<VariableHisto>
    */
   std::vector<VariableHisto> processTruthHistos(const std::vector<std::string>& filePaths,
                                                 const std::shared_ptr<Sample>& sample,
-                                                const UniqueSampleID& id);
+                                                const UniqueSampleID& id,
+                                                const bool rejectAllEvents = false);
 
   /**
    * @brief Add custom variables (columns) from the config via string
@@ -731,7 +830,7 @@ private:
    * @return std::vector<CutflowContainer>
    */
   std::vector<CutflowContainer> bookCutflows(ROOT::RDF::RNode node,
-                                             const std::shared_ptr<Sample>& sample) const;
+                                             const std::shared_ptr<Sample>& sample);
 
   /**
    * @brief Prepare varaibles needed for the MC weight definitions (lumi, xsec, sumweights)
@@ -774,25 +873,28 @@ private:
    * @param filePaths
    * @param sample
    * @param id
+   * @param rejectAllEvents Reject all events
    * @return std::map<std::string, ROOT::RDF::RNode>
    */
   std::map<std::string, ROOT::RDF::RNode> prepareTruthNodes(const std::vector<std::string>& filePaths,
                                                             const std::shared_ptr<Sample>& sample,
-                                                            const UniqueSampleID& id);
+                                                            const UniqueSampleID& id,
+                                                            const bool rejectAllEvents = false);
 
 
   /**
-   * @brief Process single truth tree when running the ntupling step
+   * @brief Process single truth tree when running the ntupling step.
+   * The truth tree is read once and written to all the output files
    *
    * @param truth
    * @param filePaths
-   * @param outputPath
+   * @param outputPaths
    * @param sample
    * @param id
    */
   void processSingleTruthTreeNtuple(const std::shared_ptr<Truth>& truth,
                                     const std::vector<std::string>& filePaths,
-                                    const std::string& outputPath,
+                                    const std::vector<std::string>& outputPaths,
                                     const std::shared_ptr<Sample>& sample,
                                     const UniqueSampleID& id);
 
@@ -834,6 +936,51 @@ private:
    */
   void prepareONNXwrapper();
 
+  /**
+   * @brief Define a new column from a string expression.
+   * Uses the ahead-of-time compiled expression or the compiled function from the JIT cache if available,
+   * otherwise adds the expression to the cache
+   *
+   * @param node Input node
+   * @param name Name of the new column
+   * @param formula The expression
+   * @param isRedefine Use Redefine instead of Define
+   * @return ROOT::RDF::RNode
+   */
+  ROOT::RDF::RNode defineWithCache(ROOT::RDF::RNode node,
+                                   const std::string& name,
+                                   const std::string& formula,
+                                   const bool isRedefine = false);
+
+  /**
+   * @brief Get the node passing a selection from the prefix tree of the filters.
+   * The selection is split into the terms of its conjunction, filters for the terms that are not in the tree yet are added
+   *
+   * @param filterTree Filter nodes indexed by the sequence of terms applied, the empty sequence is the unfiltered node
+   * @param selection The selection
+   * @return ROOT::RDF::RNode
+   */
+  ROOT::RDF::RNode prefixTreeFilter(std::map<std::vector<std::string>, ROOT::RDF::RNode>& filterTree,
+                                    const std::string& selection);
+
+  /**
+   * @brief Filter the node using a string expression.
+   * Uses the ahead-of-time compiled expression or the compiled function from the JIT cache if available,
+   * otherwise adds the expression to the cache
+   *
+   * @param node Input node
+   * @param selection The expression
+   * @return ROOT::RDF::RNode
+   */
+  ROOT::RDF::RNode filterWithCache(ROOT::RDF::RNode node,
+                                   const std::string& selection);
+
+  /**
+   * @brief Write the JIT cache and generate the code for the ahead-of-time compiled expressions, if requested
+   *
+   */
+  void writeCompiledExpressions();
+
 protected:
 
   /**
@@ -866,6 +1013,30 @@ protected:
    */
   std::map<std::string, std::map<std::string, std::string> > m_variablesWithFormulaTruth;
 
+  /**
+   * @brief Cache of the compiled string expressions, nullptr if not used
+   *
+   */
+  std::unique_ptr<JitCache> m_jitCache;
+
+  /**
+   * @brief Entry ranges of the input files processed by the current job per sample, written to the histogram files
+   *
+   */
+  std::map<std::string, std::vector<Utils::FileEntryRange> > m_jobEntryRanges; //!
+
+  /**
+   * @brief All entries of the input files of all jobs per sample, used to check that no input is missing when merging the outputs of the jobs
+   *
+   */
+  std::map<std::string, std::vector<Utils::FileEntryRange> > m_jobInputRanges; //!
+
+  /**
+   * @brief Parsed weight formulas, the systematic weights reuse the parsed nominal formula
+   *
+   */
+  std::map<std::string, WeightExpression> m_weightExpressions; //!
+
   /**
    * @brief Needed for ROOT to generate the dictionary
    *
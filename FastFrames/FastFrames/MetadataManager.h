@@ -10,6 +10,7 @@
 #include "FastFrames/Metadata.h"
 #include "FastFrames/Sample.h"
 #include "FastFrames/UniqueSampleID.h"
+#include "FastFrames/Utils.h"
 
 #include "ROOT/RDFHelpers.hxx"
 
@@ -143,6 +144,17 @@ public:
   ROOT::RDF::Experimental::RDatasetSpec dataSpec(const std::shared_ptr<Sample>& sample,
                                                  const std::shared_ptr<ConfigSetting>& config) const;
 
+  /**
+   * @brief Get the entry ranges processed by the current job when the entries of all UniqueSampleIDs
+   * of a sample are split together (used with dataSpec)
+   *
+   * @param sample
+   * @param config
+   * @return std::vector<Utils::FileEntryRange>
+   */
+  std::vector<Utils::FileEntryRange> entryRanges(const std::shared_ptr<Sample>& sample,
+                                                 const std::shared_ptr<ConfigSetting>& config) const;
+
 private:
 
   /**
@@ -159,12 +171,12 @@ private:
    *
    * @param sample
    * @param id
-   * @param config
+   * @param paths Paths to the files processed by the current job
    * @return ROOT::RDF::Experimental::RSample
    */
   ROOT::RDF::Experimental::RSample singleSampleInfo(const std::shared_ptr<Sample>& sample,
                                                     const UniqueSampleID& id,
-                                                    const std::shared_ptr<ConfigSetting>& config) const;
+                                                    const std::vector<std::string>& paths) const;
 
   /**
    * @brief set sample metadata
@@ -6,6 +6,7 @@
 
 #pragma once
 
+#include "FastFrames/NtupleOutput.h"
 #include "FastFrames/Sample.h"
 
 #include <memory>
@@ -116,6 +117,20 @@ public:
    */
   inline const std::vector<std::string>& copyTrees() const {return m_copyTrees;}
 
+  /**
+   * @brief Add a named output. If outputs are added, only these are written, all from the same event loop
+   *
+   * @param output
+   */
+  inline void addOutput(const std::shared_ptr<NtupleOutput>& output) {m_outputs.emplace_back(output);}
+
+  /**
+   * @brief Get the named outputs
+   *
+   * @return const std::vector<std::shared_ptr<NtupleOutput> >&
+   */
+  inline const std::vector<std::shared_ptr<NtupleOutput> >& outputs() const {return m_outputs;}
+
 private:
 
   std::vector<std::shared_ptr<Sample> > m_samples;
@@ -127,4 +142,6 @@ private:
   std::vector<std::string> m_excludedBrances;
 
   std::vector<std::string> m_copyTrees;
+
+  std::vector<std::shared_ptr<NtupleOutput> > m_outputs;
 };
@@ -0,0 +1,121 @@
+/**
+ * @file NtupleOutput.h
+ * @brief Class storing the options of one output of the ntupling
+ *
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+/**
+ * @brief Class storing the options of one named output of the ntupling.
+ * All outputs are written from the same event loop, each with its own selection, branches and file suffix
+ *
+ */
+class NtupleOutput {
+public:
+
+  /**
+   * @brief Construct a new Ntuple Output object
+   *
+   * @param name Name of the output
+   */
+  explicit NtupleOutput(const std::string& name) noexcept;
+
+  /**
+   * @brief Deleted default constructor
+   *
+   */
+  NtupleOutput() = delete;
+
+  /**
+   * @brief Destroy the Ntuple Output object
+   *
+   */
+  ~NtupleOutput() = default;
+
+  /**
+   * @brief Get the name
+   *
+   * @return const std::string&
+   */
+  inline const std::string& name() const {return m_name;}
+
+  /**
+   * @brief Set selection
+   *
+   * @param selection
+   */
+  inline void setSelection(const std::string& selection) {m_selection = selection;}
+
+  /**
+   * @brief Get selection
+   *
+   * @return const std::string&
+   */
+  inline const std::string& selection() const {return m_selection;}
+
+  /**
+   * @brief Set the suffix added to the name of the output file
+   *
+   * @param suffix
+   */
+  inline void setFileSuffix(const std::string& suffix) {m_fileSuffix = suffix;}
+
+  /**
+   * @brief Get the suffix added to the name of the output file
+   *
+   * @return const std::string&
+   */
+  inline const std::string& fileSuffix() const {return m_fileSuffix;}
+
+  /**
+   * @brief Add a branch
+   *
+   * @param branch
+   */
+  inline void addBranch(const std::string& branch) {m_branches.emplace_back(branch);}
+
+  /**
+   * @brief Get branches
+   *
+   * @return const std::vector<std::string>&
+   */
+  inline const std::vector<std::string>& branches() const {return m_branches;}
+
+  /**
+   * @brief Add an excluded branch
+   *
+   * @param branch
+   */
+  inline void addExcludedBranch(const std::string& branch) {m_excludedBranches.emplace_back(branch);}
+
+  /**
+   * @brief Get excluded branches
+   *
+   * @return const std::vector<std::string>&
+   */
+  inline const std::vector<std::string>& excludedBranches() const {return m_excludedBranches;}
+
+  /**
+   * @brief Get the list of selected branches based on regex from branches and excluded branches
+   *
+   * @param allBranches all branches
+   * @return std::vector<std::string>
+   */
+  std::vector<std::string> listOfSelectedBranches(const std::vector<std::string>& allBranches) const;
+
+private:
+
+  std::string m_name;
+
+  std::string m_selection;
+
+  std::string m_fileSuffix;
+
+  std::vector<std::string> m_branches;
+
+  std::vector<std::string> m_excludedBranches;
+};
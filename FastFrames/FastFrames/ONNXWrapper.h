@@ -11,6 +11,7 @@
 #include "FastFrames/Logger.h"
 
 #include <onnxruntime_cxx_api.h>
+#include <string>
 #include <vector>
 
 /**
@@ -23,8 +24,19 @@ public:
    *
    * @param name Name of the model
    * @param filepaths_model_cv paths to the ONNX model files, used for cross-validation
+   * @param n_slots Number of independent copies of the sessions (one per processing slot/thread)
+   * @param intra_op_threads Number of threads used to parallelise the execution within a node
+   * @param inter_op_threads Number of threads used to parallelise the execution of the graph (across nodes)
+   * @param optimization_level Optimisation level of the model graph
+   * @param optimized_model_directory Directory where the optimised models are stored and read from, not used if empty
    */
-  ONNXWrapper(const std::string& name, const std::vector<std::string>& filepaths_model_cv);
+  ONNXWrapper(const std::string& name,
+              const std::vector<std::string>& filepaths_model_cv,
+              const unsigned n_slots = 1,
+              const int intra_op_threads = 1,
+              const int inter_op_threads = 1,
+              const GraphOptimizationLevel optimization_level = GraphOptimizationLevel::ORT_ENABLE_EXTENDED,
+              const std::string& optimized_model_directory = "");
 
   /**
    * @brief Destroy the ONNXWrapper object
@@ -46,13 +58,16 @@ public:
    * @brief General purpose method to run inference. Don't directly use this method, use the ONNXWrapper::Inference object instead, if possible.
    *
    * @param input_tensors list of inputs
+   * @param index_network which model file to use for inference, used from cross-validation
+   * @param slot processing slot, each slot has its own sessions
    * @return std::vector<Ort::Value>
    */
   inline std::vector<Ort::Value> evaluate(
     std::vector<Ort::Value>& input_tensors,
-    unsigned index_network = 0
+    unsigned index_network = 0,
+    unsigned slot = 0
   ) {
-    Ort::Session& session = *m_sessions[index_network];
+    Ort::Session& session = *m_sessions[slot][index_network];
 
     auto output_tensors = session.Run(Ort::RunOptions{nullptr}, m_input_names_cstr.data(), input_tensors.data(), input_tensors.size(), m_output_names_cstr.data(), m_output_names_cstr.size());
     return output_tensors;
@@ -63,14 +78,14 @@ public:
    *
    * @param infer ONNXWrapper::Inference object created using createInferenceInstance()
    * @param index_network which model file to use for inference, used from cross-validation
-   * @return std::vector<Ort::Value>
+   * @param slot processing slot, each slot has its own sessions
    */
-  inline void evaluate(Inference& infer, unsigned index_network=0) {
+  inline void evaluate(Inference& infer, unsigned index_network=0, unsigned slot=0) {
     if (&infer.m_onnx != this) {
       LOG(ERROR) << "This ONNXWrapper::Inference instance is not created from this ONNXWrapper object.\n";
       return;
     }
-    infer.m_output_tensors = evaluate(infer.m_input_tensors, index_network);
+    infer.m_output_tensors = evaluate(infer.m_input_tensors, index_network, slot);
   }
 
   /**
@@ -80,7 +95,27 @@ public:
    * @return unsigned int
    */
   virtual unsigned getSessionIndex(unsigned long long eventNumber) {
-    return eventNumber % m_sessions.size();
+    return eventNumber % m_sessions.front().size();
+  }
+
+  /**
+   * @brief Number of the processing slots, i.e. the independent copies of the sessions
+   *
+   * @return unsigned
+   */
+  inline unsigned nSlots() const {return m_sessions.size();}
+
+  /**
+   * @brief Do all the input layers have a dynamic (or 1) first dimension, i.e. can several inputs be evaluated in one batch?
+   *
+   * @return true
+   * @return false
+   */
+  inline bool hasDynamicBatch() const {
+    for (const auto& shape : m_input_shapes) {
+      if (shape.size() != 2 || shape.front() >= 0) return false;
+    }
+    return true;
   }
 
   /**
@@ -223,11 +258,41 @@ public:
 
 protected:
 
+  /**
+   * @brief Get the path of the cached optimised model. The name contains the size and the modification time
+   * of the original model, the optimisation level and the ONNX Runtime API version so that a stale model is never used
+   *
+   * @param filepath_model Path to the original model
+   * @param optimized_model_directory Directory with the optimised models
+   * @param optimization_level Optimisation level of the model graph
+   * @return std::string Empty if the directory is not set
+   */
+  std::string optimizedModelPath(const std::string& filepath_model,
+                                 const std::string& optimized_model_directory,
+                                 const GraphOptimizationLevel optimization_level) const;
+
+  /**
+   * @brief Create the session for the model. If the directory for the optimised models is set,
+   * the optimised model is used if it exists, otherwise it is written to a temporary file when the session is created
+   * and moved to its final name afterwards, so that jobs running in parallel never read a partially written model
+   *
+   * @param filepath_model Path to the original model
+   * @param optimized_model_directory Directory with the optimised models
+   * @param optimization_level Optimisation level of the model graph
+   * @param session The created session
+   * @return std::string Path to the model to be loaded by the other sessions
+   */
+  std::string createFirstSession(const std::string& filepath_model,
+                                 const std::string& optimized_model_directory,
+                                 const GraphOptimizationLevel optimization_level,
+                                 std::shared_ptr<Ort::Session>& session) const;
+
   std::string m_model_name;
   // ort
   std::shared_ptr<Ort::Env> m_env;
   std::shared_ptr<Ort::SessionOptions> m_session_options;
-  std::vector<std::shared_ptr<Ort::Session>> m_sessions;
+  // sessions per processing slot and per fold, so that slots do not share sessions
+  std::vector<std::vector<std::shared_ptr<Ort::Session>>> m_sessions;
   std::vector<std::string> m_input_node_names;
   std::vector<std::string> m_output_node_names;
   std::vector<const char*> m_input_names_cstr;
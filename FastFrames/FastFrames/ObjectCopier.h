@@ -10,9 +10,7 @@
 #include <string>
 #include <vector>
 
-class TEfficiency;
-class TH1;
-class TFile;
+class TObject;
 
 /**
  * @brief Class responsible for copying metedata from input ntuple to output ntuple
@@ -55,37 +53,56 @@ public:
   void copyObjectsTo(const std::string& outputPath) const;
 
   /**
-   * @brief Copy trees if requested
+   * @brief Do the actual copying of importanat information to several output files.
+   * The objects are merged only once and written to all the outputs
    *
-   * @param outputPath Output ROOT file path
+   * @param outputPaths
+   */
+  void copyObjectsTo(const std::vector<std::string>& outputPaths) const;
+
+  /**
+   * @brief Copy trees if requested.
+   * Each tree is read once and written to all the output files in the same event loop
+   *
+   * @param outputPaths Output ROOT file paths
    * @param trees List of the tree names
    * @param convertVecToRVec
+   * @param format Output format, "ttree" or "rntuple"
    */
-  void copyTreesTo(const std::string& outputPath,
+  void copyTreesTo(const std::vector<std::string>& outputPaths,
                    const std::vector<std::string>& trees,
-                   const bool convertVecToRVec) const;
+                   const bool convertVecToRVec,
+                   const std::string& format = "ttree") const;
 
 private:
 
   /**
-   * @brief Merge same histograms from multiple files
+   * @brief Merge the histograms and TEfficiency objects from all the files.
+   * The files are split into contiguous blocks processed in parallel (when implicit multithreading is enabled),
+   * so only one file per block is open at a time. The partial sums of the blocks are then merged pairwise in parallel
+   *
+   * @return std::vector<std::unique_ptr<TObject> > merged objects, in the order of the object list (nullptr for trees)
+   */
+  std::vector<std::unique_ptr<TObject> > mergeObjects() const;
+
+  /**
+   * @brief Sum the objects from a range of files, opening one file at a time and reading all the objects in one visit
    *
-   * @param name name of the histogram
-   * @param files list of files
-   * @return std::unique_ptr<TH1>
+   * @param firstFile Index of the first file
+   * @param lastFile Index after the last file
+   * @return std::vector<std::unique_ptr<TObject> > partial sums, in the order of the object list (nullptr for trees)
    */
-  std::unique_ptr<TH1> mergeHistos(const std::string& name,
-                                   const std::vector<std::unique_ptr<TFile> >& files) const;
+  std::vector<std::unique_ptr<TObject> > sumObjectsFromFiles(const std::size_t firstFile,
+                                                             const std::size_t lastFile) const;
 
   /**
-   * @brief Merge same TEfficiency plots
+   * @brief Add objects to the target, the other objects are consumed
    *
-   * @param name name of the TEfficiency object
-   * @param files list of files
-   * @return std::unique_ptr<TEfficiency>
+   * @param target
+   * @param other
    */
-  std::unique_ptr<TEfficiency> mergeEfficiencies(const std::string& name,
-                                                 const std::vector<std::unique_ptr<TFile> >& files) const;
+  void addObjects(std::vector<std::unique_ptr<TObject> >& target,
+                  std::vector<std::unique_ptr<TObject> >& other) const;
 
   std::vector<std::string> m_fileList;
 
@@ -12,6 +12,9 @@
 
 #include "FastFrames/Logger.h"
 
+#include "ROOT/RVec.hxx"
+
+#include <array>
 #include <string>
 #include <vector>
 #include <map>
@@ -101,18 +104,68 @@ public:
       // m_foldFormula = foldFormula;
   }
 
+  /**
+   * @brief Set the number of threads used to parallelise the execution within a node
+   *
+   * @param threads
+   */
+  inline void setIntraOpThreads(const int threads) {m_intraOpThreads = threads;}
+
+  /**
+   * @brief Get the number of threads used to parallelise the execution within a node
+   *
+   * @return int
+   */
+  inline int intraOpThreads() const {return m_intraOpThreads;}
+
+  /**
+   * @brief Set the number of threads used to parallelise the execution of the graph (across nodes)
+   *
+   * @param threads
+   */
+  inline void setInterOpThreads(const int threads) {m_interOpThreads = threads;}
+
+  /**
+   * @brief Get the number of threads used to parallelise the execution of the graph (across nodes)
+   *
+   * @return int
+   */
+  inline int interOpThreads() const {return m_interOpThreads;}
+
+  /**
+   * @brief Set the graph optimisation level, one of "disable", "basic", "extended", "all"
+   *
+   * @param level
+   */
+  inline void setGraphOptimizationLevel(const std::string& level) {m_graphOptimizationLevel = level;}
+
+  /**
+   * @brief Get the graph optimisation level
+   *
+   * @return const std::string&
+   */
+  inline const std::string& graphOptimizationLevel() const {return m_graphOptimizationLevel;}
+
+  /**
+   * @brief Set the directory where the optimised models are stored and read from (empty means no caching)
+   *
+   * @param directory
+   */
+  inline void setOptimizedModelDirectory(const std::string& directory) {m_optimizedModelDirectory = directory;}
+
+  /**
+   * @brief Get the directory where the optimised models are stored and read from
+   *
+   * @return const std::string&
+   */
+  inline const std::string& optimizedModelDirectory() const {return m_optimizedModelDirectory;}
+
   /**
    * @brief Initialize the underlying ONNXWrapper object with the given model paths
    *
+   * @param nSlots Number of processing slots, each slot gets its own copy of the sessions
    */
-  inline void initializeModels() {
-    #ifdef ONNXRUNTIME_AVAILABLE
-      m_onnx =  std::make_unique<ONNXWrapper>(m_name, m_modelPaths);
-    #else
-      LOG(WARNING) << "You are trying to use ONNX wrapper, but the onnxruntime is not available. Please rerun cmake and recompile with onnxruntime.\n";
-      return;
-    #endif
-  }
+  void initializeModels(const unsigned nSlots = 1);
 
   /**
    * @brief Runs k-fold inference
@@ -124,6 +177,141 @@ public:
    */
   std::vector<float> runInference(const std::string& outputLayer, const unsigned long long& eventNumber, const std::map<std::string, std::vector<float>>& inputs)   const;
 
+  /**
+   * @brief Runs k-fold inference for a batch of input vectors (e.g. the systematic variations of one event) with a single model evaluation.
+   * All output layers are retrieved from the same evaluation.
+   * If the model does not support dynamic batch size, the inputs are evaluated one by one
+   *
+   * @param slot Processing slot, selects the sessions to use
+   * @param eventNumber Event number of the corresponding event, used for k-fold inference
+   * @param inputs Packed input values, one per input layer (in the order of getInputMap()) for each batch entry
+   * @param nInputs Number of the inputs (number of the batch entries times the number of the input layers)
+   * @return For each batch entry, the values of all output layers concatenated in the order of getOutputMap() (nOutputValues() values per entry).
+   * The returned RVec does not own the memory, it is a view of a per-slot buffer valid until the next call in the same slot.
+   * In the event loop the next call happens for the next entry of the slot, so the view must not be kept beyond the current entry
+   * and must not be modified; the output columns are copies of its slices
+   */
+  ROOT::VecOps::RVec<float> runBatchInference(const unsigned int slot,
+                                              const unsigned long long eventNumber,
+                                              const ROOT::VecOps::RVec<float>* const* inputs,
+                                              const std::size_t nInputs) const;
+
+  /**
+   * @brief Runs k-fold inference for one systematic variation of an event, reusing the nominal outputs if the inputs are unchanged.
+   * Used for models with a fixed batch size, where each variation is evaluated only when its outputs are requested
+   *
+   * @param slot Processing slot, selects the sessions to use
+   * @param eventNumber Event number of the corresponding event, used for k-fold inference
+   * @param nominalResult Outputs of the nominal inputs (see runBatchInference())
+   * @param inputs Packed nominal input values, one per input layer, followed by the packed input values of the variation
+   * @param nInputs Number of the inputs (twice the number of the input layers)
+   * @return Values of all output layers of the variation, the returned RVec owns its memory
+   */
+  ROOT::VecOps::RVec<float> runVariationInference(const unsigned int slot,
+                                                  const unsigned long long eventNumber,
+                                                  const ROOT::VecOps::RVec<float>& nominalResult,
+                                                  const ROOT::VecOps::RVec<float>* const* inputs,
+                                                  const std::size_t nInputs) const;
+
+  /**
+   * @brief Can several inputs be evaluated in one batch, i.e. does the model have a dynamic batch size?
+   *
+   * @return true
+   * @return false
+   */
+  bool hasDynamicBatch() const;
+
+  /**
+   * @brief Register an instance so that it can be used from JIT-compiled expressions (see evaluateBatch())
+   *
+   * @param instance The instance, needs to be alive when the expressions are evaluated
+   * @return std::size_t The index of the registered instance
+   */
+  static std::size_t registerInstance(const SimpleONNXInference* instance);
+
+  /**
+   * @brief Remove all registered instances, the JIT-compiled expressions using them must not be evaluated afterwards
+   *
+   */
+  static void clearRegisteredInstances();
+
+  /**
+   * @brief Get the registered instance
+   *
+   * @param index Index returned by registerInstance()
+   * @return const SimpleONNXInference*
+   */
+  static const SimpleONNXInference* registeredInstance(const std::size_t index);
+
+  /**
+   * @brief Run the batched inference of a registered instance on any number of packed input columns.
+   * Used from JIT-compiled expressions as the number of the inputs is only known at runtime
+   *
+   * @tparam T Types of the packed inputs (ROOT::VecOps::RVec<float>)
+   * @param index Index of the registered instance
+   * @param slot Processing slot
+   * @param eventNumber Event number
+   * @param inputs The packed inputs, one per input layer for each batch entry
+   * @return ROOT::VecOps::RVec<float> View of the slot buffer, see runBatchInference() for its lifetime
+   */
+  template <typename... T>
+  static ROOT::VecOps::RVec<float> evaluateBatch(const std::size_t index,
+                                                 const unsigned int slot,
+                                                 const unsigned long long eventNumber,
+                                                 const T&... inputs) {
+    const std::array<const ROOT::VecOps::RVec<float>*, sizeof...(T)> pointers{&inputs...};
+    return SimpleONNXInference::registeredInstance(index)->runBatchInference(slot, eventNumber, pointers.data(), pointers.size());
+  }
+
+  /**
+   * @brief Run the inference of a registered instance on the nominal inputs of an event.
+   * Used from JIT-compiled expressions for models with a fixed batch size, the result owns its memory
+   *
+   * @tparam T Types of the packed inputs (ROOT::VecOps::RVec<float>)
+   * @param index Index of the registered instance
+   * @param slot Processing slot
+   * @param eventNumber Event number
+   * @param inputs The packed nominal inputs, one per input layer
+   * @return ROOT::VecOps::RVec<float>
+   */
+  template <typename... T>
+  static ROOT::VecOps::RVec<float> evaluateNominal(const std::size_t index,
+                                                   const unsigned int slot,
+                                                   const unsigned long long eventNumber,
+                                                   const T&... inputs) {
+    const ROOT::VecOps::RVec<float> view = SimpleONNXInference::evaluateBatch(index, slot, eventNumber, inputs...);
+    return ROOT::VecOps::RVec<float>(view.begin(), view.end());
+  }
+
+  /**
+   * @brief Run the inference of a registered instance on the inputs of one systematic variation of an event (see runVariationInference()).
+   * Used from JIT-compiled expressions for models with a fixed batch size
+   *
+   * @tparam T Types of the packed inputs (ROOT::VecOps::RVec<float>)
+   * @param index Index of the registered instance
+   * @param slot Processing slot
+   * @param eventNumber Event number
+   * @param nominalResult Outputs of the nominal inputs
+   * @param inputs The packed nominal inputs followed by the packed inputs of the variation, one per input layer
+   * @return ROOT::VecOps::RVec<float>
+   */
+  template <typename... T>
+  static ROOT::VecOps::RVec<float> evaluateVariation(const std::size_t index,
+                                                     const unsigned int slot,
+                                                     const unsigned long long eventNumber,
+                                                     const ROOT::VecOps::RVec<float>& nominalResult,
+                                                     const T&... inputs) {
+    const std::array<const ROOT::VecOps::RVec<float>*, sizeof...(T)> pointers{&inputs...};
+    return SimpleONNXInference::registeredInstance(index)->runVariationInference(slot, eventNumber, nominalResult, pointers.data(), pointers.size());
+  }
+
+  /**
+   * @brief Total number of the output values of all output layers (for one input)
+   *
+   * @return std::size_t
+   */
+  std::size_t nOutputValues() const;
+
   inline std::vector<std::string> getInputColumnNames() {
       std::vector<std::string> columnNames{"eventNumber"};
       for (const auto &[input_name, branches]: m_inputs) {
@@ -153,46 +341,30 @@ public:
   }
 
 
-  /**
-   * @brief Helper class to dispatch one uint64_t and multiple float arguments to a function
-   *
-   * @note Use the variadicDispatch<N>(f) function to create an object of this class
-   */
-  template <typename I, typename F>
-  class VariadicDispatcher;
-
-  template <std::size_t... N, typename F>
-  class VariadicDispatcher<std::index_sequence<N...>, F> {
-    template <std::size_t>
-    using RepeatedT = float;
-    std::decay_t<F> fFunc;
-
-  public:
-    explicit VariadicDispatcher(F &&f) : fFunc(f) {}
-    auto operator()(unsigned long long eventNumber, RepeatedT<N>... args) { return fFunc(eventNumber, {args...}); }
-  };
+private:
 
   /**
-   * @brief Helper function to dispatch one uint64_t and multiple float arguments to a function
+   * @brief Buffers reused between the evaluations in one processing slot
    *
-   * @tparam N Number of float arguments
-   * @tparam F Function type
-   * @param f Function to dispatch the arguments to
-   * @return VariadicDispatcher object
    */
-  template <std::size_t N, typename F>
-  static auto variadicDispatch(F &&f)
-  {
-    return VariadicDispatcher<std::make_index_sequence<N>, F>(f);
-  }
-
-private:
+  struct SlotBuffers {
+    std::vector<std::vector<float> > layerValues;
+    std::vector<const ROOT::VecOps::RVec<float>*> uniqueInputs;
+    std::vector<std::size_t> uniqueIndices;
+    std::vector<float> uniqueResults;
+    std::vector<float> results;
+  };
 
   std::string m_name;
   std::vector<std::string> m_modelPaths;
   std::map<std::string, std::vector<std::string>> m_inputs;
   std::map<std::string, std::vector<std::string>> m_outputs;
   std::string m_foldFormula;
+  int m_intraOpThreads = 1;
+  int m_interOpThreads = 1;
+  std::string m_graphOptimizationLevel = "extended";
+  std::string m_optimizedModelDirectory;
+  mutable std::vector<SlotBuffers> m_slotBuffers;
   #ifdef ONNXRUNTIME_AVAILABLE
     std::unique_ptr<ONNXWrapper> m_onnx;
   #endif
@@ -0,0 +1,248 @@
+/**
+ * @file SortedTreeIndex.h
+ * @brief Index of a tree based on a sorted array of keys, used for matching reco and truth trees
+ *
+ */
+
+#pragma once
+
+#include "TVirtualIndex.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+class TLeaf;
+
+/**
+ * @brief Replacement of TTreeIndex used when attaching a truth tree as a friend of the reco tree.
+ * The (major, minor) keys of all entries are read directly from the index branches of each file (in parallel
+ * when implicit multithreading is enabled), sorted per file and merged into one compact array.
+ * The lookup for a reco entry is a binary search in this array.
+ * The values in the reco tree are read directly from its leaves as 64-bit integers.
+ * Copies of the index (made by RDataFrame for every processing slot) share the same array.
+ * Optionally, the sorted keys of each file are cached in a file next to the input and memory-mapped in the following runs.
+ *
+ */
+class SortedTreeIndex : public TVirtualIndex {
+public:
+
+  /**
+   * @brief Key of one entry of the indexed tree
+   *
+   */
+  struct Key {
+    Long64_t major;
+    Long64_t minor;
+    Long64_t entry;
+
+    /**
+     * @brief Order by major, minor and then by entry
+     *
+     * @param other
+     * @return true
+     * @return false
+     */
+    inline bool operator<(const Key& other) const {
+      if (major != other.major) return major < other.major;
+      if (minor != other.minor) return minor < other.minor;
+      return entry < other.entry;
+    }
+  };
+
+  /**
+   * @brief Construct a new Sorted Tree Index object and build the index
+   *
+   * @param tree The tree (chain) to be indexed, built from the files in the same order
+   * @param treeName Name of the tree in the files
+   * @param files Paths to the files
+   * @param majorName Name of the major index branch
+   * @param minorName Name of the minor index branch, "0" if only the major index is used
+   * @param useCache Read/write the keys of each file from/to a cache file next to the input
+   */
+  SortedTreeIndex(TTree* tree,
+                  const std::string& treeName,
+                  const std::vector<std::string>& files,
+                  const std::string& majorName,
+                  const std::string& minorName,
+                  const bool useCache = false);
+
+  /**
+   * @brief Copy constructor, the keys are shared, the cached leaves are not
+   *
+   * @param other
+   */
+  SortedTreeIndex(const SortedTreeIndex& other);
+
+  /**
+   * @brief Deleted assignment operator
+   *
+   */
+  SortedTreeIndex& operator=(const SortedTreeIndex&) = delete;
+
+  /**
+   * @brief Destroy the Sorted Tree Index object, removes it from the tree
+   *
+   */
+  ~SortedTreeIndex() override;
+
+  /**
+   * @brief Read the keys of one file
+   *
+   * @param path Path to the file
+   * @param treeName Name of the tree
+   * @param majorName Name of the major index branch
+   * @param minorName Name of the minor index branch, "0" if not used
+   * @param useCache Read the keys from the cache file if it is valid, write it otherwise
+   * @return std::vector<Key> Keys sorted, the entries are local to the file
+   */
+  static std::vector<Key> keysFromFile(const std::string& path,
+                                       const std::string& treeName,
+                                       const std::string& majorName,
+                                       const std::string& minorName,
+                                       const bool useCache = false);
+
+  /**
+   * @brief Path to the cache file of the keys, empty if the input cannot be cached (not a local file)
+   *
+   * @param path Path to the input file
+   * @param treeName
+   * @param majorName
+   * @param minorName
+   * @return std::string
+   */
+  static std::string cachePath(const std::string& path,
+                               const std::string& treeName,
+                               const std::string& majorName,
+                               const std::string& minorName);
+
+  /**
+   * @brief Not supported, the index is built for the whole chain at once
+   *
+   */
+  void Append(const TVirtualIndex*, bool delaySort = false) override;
+
+  /**
+   * @brief Get the entry of the indexed tree matching the current entry of the parent tree
+   *
+   * @param parent The parent tree
+   * @return Long64_t -1 if not found
+   */
+  Long64_t GetEntryNumberFriend(const TTree* parent) override;
+
+  /**
+   * @brief Get the entry with the given key
+   *
+   * @param major
+   * @param minor
+   * @return Long64_t -1 if not found
+   */
+  Long64_t GetEntryNumberWithIndex(Long64_t major, Long64_t minor) const override;
+
+  /**
+   * @brief Get the entry with the given key or, if not found, the entry with the largest smaller key
+   *
+   * @param major
+   * @param minor
+   * @return Long64_t -1 if not found
+   */
+  Long64_t GetEntryNumberWithBestIndex(Long64_t major, Long64_t minor) const override;
+
+  /**
+   * @brief Get the name of the major index branch
+   *
+   * @return const char*
+   */
+  const char* GetMajorName() const override {return m_majorName.c_str();}
+
+  /**
+   * @brief Get the name of the minor index branch
+   *
+   * @return const char*
+   */
+  const char* GetMinorName() const override {return m_minorName.c_str();}
+
+  /**
+   * @brief Get the number of entries in the index
+   *
+   * @return Long64_t
+   */
+  Long64_t GetN() const override {return m_keys->size();}
+
+  /**
+   * @brief Is the index usable for the parent, i.e. are the index branches present
+   *
+   * @param parent
+   * @return true
+   * @return false
+   */
+  bool IsValidFor(const TTree* parent) override;
+
+  /**
+   * @brief Called when the parent changes file, the cached leaves are updated on the next lookup
+   *
+   */
+  void UpdateFormulaLeaves(const TTree*) override;
+
+  /**
+   * @brief Set the indexed tree
+   *
+   * @param tree
+   */
+  void SetTree(TTree* tree) override;
+
+  /**
+   * @brief Copy of the index sharing the keys, used by RDataFrame for the processing slots
+   *
+   * @return TObject*
+   */
+  TObject* Clone(const char* newname = "") const override;
+
+private:
+
+  /**
+   * @brief Read the keys from a cache file (memory-mapped)
+   *
+   * @param cachePath Path to the cache file
+   * @param uuid UUID of the input file, the cache is only used if it matches
+   * @param nEntries Number of entries of the tree, the cache is only used if it matches
+   * @param keys Filled with the keys
+   * @return true if the cache was valid and read
+   * @return false
+   */
+  static bool readCache(const std::string& cachePath,
+                        const std::string& uuid,
+                        const Long64_t nEntries,
+                        std::vector<Key>* keys);
+
+  /**
+   * @brief Write the keys to a cache file, failures are ignored (e.g. read-only directory)
+   *
+   * @param cachePath Path to the cache file
+   * @param uuid UUID of the input file
+   * @param keys
+   */
+  static void writeCache(const std::string& cachePath,
+                         const std::string& uuid,
+                         const std::vector<Key>& keys);
+
+  /**
+   * @brief Read the value of a leaf of the parent tree for its current entry
+   *
+   * @param leaf
+   * @param entry
+   * @return Long64_t
+   */
+  static Long64_t leafValue(TLeaf* leaf, const Long64_t entry);
+
+  std::string m_majorName;
+  std::string m_minorName;
+
+  // sorted keys shared between all the copies
+  std::shared_ptr<const std::vector<Key> > m_keys;
+
+  // leaves of the current tree of the parent, updated when the parent changes the file
+  const TTree* m_parentTree = nullptr;
+  TLeaf* m_parentMajor = nullptr;
+  TLeaf* m_parentMinor = nullptr;
+};
@@ -329,4 +329,14 @@ namespace StringOperations  {
      */
     std::string joinStrings(const std::string &separator, const std::vector<std::string> &strings);
 
+    /**
+     * @brief Split a logical expression into the terms of its top-level conjunction ("&&"), keeping their order.
+     * Brackets enclosing a term (or the whole expression) are removed and the terms are split recursively.
+     * Expressions that cannot be split safely (top-level "||", "?", "," or unbalanced brackets) are returned as a single term
+     *
+     * @param expression
+     * @return std::vector<std::string>
+     */
+    std::vector<std::string> splitConjunction(const std::string &expression);
+
 }
\ No newline at end of file
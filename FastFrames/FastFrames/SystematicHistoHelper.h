@@ -0,0 +1,127 @@
+/**
+ * @file SystematicHistoHelper.h
+ * @brief Custom RDataFrame action filling histograms for many systematic variations at once
+ *
+ */
+
+#pragma once
+
+#include "ROOT/RDF/HistoModels.hxx"
+#include "ROOT/RDF/RActionImpl.hxx"
+#include "ROOT/RVec.hxx"
+#include "TH1D.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+class TTreeReader;
+
+/**
+ * @brief Custom RDataFrame action that fills a contiguous block of 1D histograms
+ * (one per systematic variation) in a single call.
+ * The values, the weights and the flags telling if the event passes the selection of the given variation
+ * are provided as packed arrays with one element per histogram.
+ * For weight-only variations, only the nominal value and the packed weights are needed.
+ * This replaces one Histo1D action per systematic with a single action per region and variable.
+ *
+ */
+class SystematicHisto1DHelper : public ROOT::Detail::RDF::RActionImpl<SystematicHisto1DHelper> {
+public:
+
+  /**
+   * @brief Type of the result
+   *
+   */
+  using Result_t = std::vector<TH1D>;
+
+  /**
+   * @brief Construct a new Systematic Histo 1D Helper object
+   *
+   * @param model Histogram model used for all the histograms
+   * @param nHistos Number of the histograms (systematic variations) to fill
+   * @param nSlots Number of the processing slots
+   */
+  explicit SystematicHisto1DHelper(const ROOT::RDF::TH1DModel& model,
+                                   const std::size_t nHistos,
+                                   const unsigned int nSlots);
+
+  /**
+   * @brief Deleted copy constructor
+   *
+   */
+  SystematicHisto1DHelper(const SystematicHisto1DHelper&) = delete;
+
+  /**
+   * @brief Default move constructor
+   *
+   */
+  SystematicHisto1DHelper(SystematicHisto1DHelper&&) = default;
+
+  /**
+   * @brief Destroy the Systematic Histo 1D Helper object
+   *
+   */
+  ~SystematicHisto1DHelper() = default;
+
+  /**
+   * @brief Get the pointer to the result
+   *
+   * @return std::shared_ptr<Result_t>
+   */
+  std::shared_ptr<Result_t> GetResultPtr() const {return m_result;}
+
+  /**
+   * @brief Called before the event loop
+   *
+   */
+  void Initialize() {}
+
+  /**
+   * @brief Called at the beginning of each task
+   *
+   */
+  void InitTask(TTreeReader*, unsigned int) {}
+
+  /**
+   * @brief Fill all histograms for one event
+   *
+   * @param slot Processing slot
+   * @param values Packed values, one per histogram
+   * @param weights Packed weights, one per histogram
+   * @param passed Packed flags, the histogram is filled only if the flag is true
+   */
+  void Exec(unsigned int slot,
+            const ROOT::VecOps::RVec<double>& values,
+            const ROOT::VecOps::RVec<double>& weights,
+            const ROOT::VecOps::RVec<bool>& passed);
+
+  /**
+   * @brief Fill all histograms for one event with the same value, but different weights
+   * Used for systematics that only change the weight (share the selection and the variable with nominal)
+   *
+   * @param slot Processing slot
+   * @param value Value used for all histograms
+   * @param weights Packed weights, one per histogram
+   */
+  void Exec(unsigned int slot,
+            const double value,
+            const ROOT::VecOps::RVec<double>& weights);
+
+  /**
+   * @brief Merge the histograms from the processing slots
+   *
+   */
+  void Finalize();
+
+  /**
+   * @brief Get the name of the action
+   *
+   * @return std::string
+   */
+  std::string GetActionName() const {return "SystematicHisto1D";}
+
+private:
+  std::shared_ptr<Result_t> m_result;
+  std::vector<std::vector<TH1D> > m_perSlotHistos;
+};
@@ -9,6 +9,9 @@
 #include <map>
 #include <memory>
 #include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
 #include <vector>
 
 class Systematic;
@@ -96,7 +99,7 @@ public:
    *
    * @param name Name of the branch
    */
-  void addBranch(const std::string& name) {m_allBranches.emplace_back(name);}
+  void addBranch(const std::string& name);
 
   /**
    * @brief Get list of branches in the original tree + the ones added via systematicDefine.
@@ -206,6 +209,43 @@ public:
   void setSystematicNames(const std::vector<std::string>& systematics) {m_systematics = systematics;}
 
 private:
+
+  /**
+   * @brief Split the formula into identifiers containing "NOSYS" (that can be replaced) and the rest.
+   * The result is cached as it does not depend on the systematic
+   *
+   * @param formula
+   * @return const std::vector<std::pair<std::string, bool> >& List of the parts, the flag tells if the part can be replaced
+   */
+  const std::vector<std::pair<std::string, bool> >& tokenise(const std::string& formula) const;
+
+  /**
+   * @brief Replace a single identifier for a given systematic if it is affected by the systematic.
+   * Identifiers with "." (e.g. "truth.branch_NOSYS") are also checked per part if not found
+   *
+   * @param token The identifier
+   * @param systematicName
+   * @return std::string
+   */
+  std::string replaceToken(const std::string& token, const std::string& systematicName) const;
+
+  /**
+   * @brief Is the branch affected by the systematic?
+   *
+   * @param branch
+   * @param systematicName
+   * @return true
+   * @return false
+   */
+  bool isAffected(const std::string& branch, const std::string& systematicName) const;
+
+  /**
+   * @brief Remove the cached replacements for a given systematic
+   *
+   * @param systematicName
+   */
+  void invalidateCache(const std::string& systematicName);
+
   /**
    * @brief map where the key is the name of the systematic
    * and the value is the list of branches affected by the systematic
@@ -226,9 +266,27 @@ private:
    */
   std::vector<std::string> m_allBranches;
 
+  /**
+   * @brief set of all branches for fast lookup
+   *
+   */
+  std::unordered_set<std::string> m_allBranchesSet;
+
   /**
    * @brief names of all systematics
    *
    */
   std::vector<std::string> m_systematics;
+
+  /**
+   * @brief cache of the tokenised formulas
+   *
+   */
+  mutable std::unordered_map<std::string, std::vector<std::pair<std::string, bool> > > m_tokenisedFormulas;
+
+  /**
+   * @brief cache of the replaced formulas, per systematic name and original formula
+   *
+   */
+  mutable std::unordered_map<std::string, std::unordered_map<std::string, std::string> > m_replacedFormulas;
 };
@@ -10,6 +10,7 @@
 #include "FastFrames/Region.h"
 #include "FastFrames/Variable.h"
 
+#include "ROOT/RDataFrame.hxx"
 #include "ROOT/RDFHelpers.hxx"
 #include "TChain.h"
 #include "TH1D.h"
@@ -32,7 +33,8 @@ class Sample;
 namespace Utils {
 
   /**
-   * @brief Get TChain from input file paths
+   * @brief Get TChain from input file paths.
+   * Returns nullptr if the inputs are RNTuples, use dataFrameFromFiles to read them
    *
    * @param treeName
    * @param files
@@ -41,6 +43,37 @@ namespace Utils {
   std::unique_ptr<TChain> chainFromFiles(const std::string& treeName,
                                          const std::vector<std::string>& files);
 
+  /**
+   * @brief Check if the object with the given name stored in the first file is an RNTuple
+   *
+   * @param name Name of the tree/RNTuple
+   * @param files Input files
+   * @return true
+   * @return false
+   */
+  bool isRNTuple(const std::string& name, const std::vector<std::string>& files);
+
+  /**
+   * @brief Get RDataFrame from input file paths.
+   * TTrees are read from the chain (so that the friend trees are kept), RNTuples are read directly from the files
+   *
+   * @param name Name of the tree/RNTuple
+   * @param files Input files
+   * @param chain The chain from chainFromFiles, nullptr for RNTuple inputs
+   * @return ROOT::RDataFrame
+   */
+  ROOT::RDataFrame dataFrameFromFiles(const std::string& name,
+                                      const std::vector<std::string>& files,
+                                      const std::unique_ptr<TChain>& chain);
+
+  /**
+   * @brief Set the output format of Snapshot
+   *
+   * @param opts Snapshot options to update
+   * @param format "ttree" or "rntuple"
+   */
+  void setSnapshotFormat(ROOT::RDF::RSnapshotOptions& opts, const std::string& format);
+
   /**
    * @brief Get 2D histo model (TH2D) from variables
    *
@@ -95,6 +128,82 @@ namespace Utils {
                                             const int split,
                                             const int index);
 
+  /**
+   * @brief Range of entries [firstEntry, lastEntry) of one input file processed by a job
+   *
+   */
+  struct FileEntryRange {
+    std::string path;
+    long long firstEntry;
+    long long lastEntry;
+    long long nEntries;
+  };
+
+  /**
+   * @brief Get the number of entries of a tree in a file, the values are cached for the files that were already read
+   *
+   * @param path Path to the file
+   * @param treeName Name of the tree
+   * @return long long
+   */
+  long long entriesInFile(const std::string& path, const std::string& treeName);
+
+  /**
+   * @brief Split the entries of the input files into equal ranges and get the ranges for the current job.
+   * Files without entries are assigned to the job where they would start
+   *
+   * @param fileList Input file list
+   * @param treeName Name of the tree used to count the entries
+   * @param split Number of jobs
+   * @param index Current index of a job
+   * @return std::vector<FileEntryRange>
+   */
+  std::vector<FileEntryRange> selectedEntryRanges(const std::vector<std::string>& fileList,
+                                                  const std::string& treeName,
+                                                  const int split,
+                                                  const int index);
+
+  /**
+   * @brief Get the ranges covering all entries of the input files, i.e. the input of all the jobs together
+   *
+   * @param fileList Input file list
+   * @param treeName Name of the tree used to count the entries
+   * @return std::vector<FileEntryRange>
+   */
+  std::vector<FileEntryRange> fullEntryRanges(const std::vector<std::string>& fileList,
+                                              const std::string& treeName);
+
+  /**
+   * @brief Get the file paths from the entry ranges
+   *
+   * @param ranges The ranges
+   * @param onlyFromFirstEntry Only the files processed from the first entry, i.e. the files "owned" by the job.
+   * These are used for the objects that are processed per file (metadata, truth trees) so that each file is used only by one job
+   * @return std::vector<std::string>
+   */
+  std::vector<std::string> filesFromEntryRanges(const std::vector<FileEntryRange>& ranges,
+                                                const bool onlyFromFirstEntry);
+
+  /**
+   * @brief Restrict the chain to the entry ranges with a TEntryList owned by the chain.
+   * Nothing is done if all the files are processed fully
+   *
+   * @param chain The chain built from the files of the ranges
+   * @param treeName Name of the tree
+   * @param ranges The ranges
+   */
+  void applyEntryRanges(const std::unique_ptr<TChain>& chain,
+                        const std::string& treeName,
+                        const std::vector<FileEntryRange>& ranges);
+
+  /**
+   * @brief Text representation of the entry ranges, one line per file with: path, first entry, last entry, number of entries
+   *
+   * @param ranges
+   * @return std::string
+   */
+  std::string entryRangesToString(const std::vector<FileEntryRange>& ranges);
+
   /**
    * @brief Set histogram to be between 0 and 1 in each bin
    *
@@ -182,4 +291,17 @@ namespace Utils {
    */
   std::vector<std::string> getColumnsFromString(const std::string& formula,
                                                 ROOT::RDF::RNode& node);
+
+  /**
+   * @brief Get a (JITed) definition of a column that packs the provided expressions into one RVec
+   *
+   * @param type C++ type of the elements of the RVec
+   * @param elements Expressions for each element
+   * @param flagsColumn Optional name of a packed RVec<bool> column with one flag per element.
+   * When provided, an element is only evaluated when its flag is set, otherwise it is default-initialised
+   * @return std::string
+   */
+  std::string packedColumnDefinition(const std::string& type,
+                                     const std::vector<std::string>& elements,
+                                     const std::string& flagsColumn = "");
 }
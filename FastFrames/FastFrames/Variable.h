@@ -202,6 +202,14 @@ public:
    */
   inline VariableType type() const {return m_type;}
 
+  /**
+   * @brief Is the type of the variable a known scalar type (not a vector)
+   *
+   * @return true
+   * @return false
+   */
+  inline bool hasScalarType() const {return m_type != VariableType::UNDEFINED && m_type < VariableType::VECTOR_CHAR;}
+
 private:
   std::string m_name;
   std::string m_definition;
@@ -0,0 +1,233 @@
+/**
+ * @file WeightExpression.h
+ * @brief Compiled evaluation of weight formulas that are products of columns
+ *
+ */
+
+#pragma once
+
+#include "ROOT/RDataFrame.hxx"
+
+#include <array>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Class that parses a weight formula into a product (and ratio) of columns and numerical constants.
+ * Such formulas are defined as new columns using a compiled functor instead of a JIT-compiled string,
+ * formulas that cannot be parsed need to be defined with the string (JIT) version.
+ * The formulas with a division of integers (e.g. "1/2") are also left to the JIT version to keep the C++ integer division.
+ * The product is evaluated in double precision, products of float columns can therefore differ from the JIT version at the level of the float precision.
+ *
+ */
+class WeightExpression {
+public:
+
+  /**
+   * @brief Construct a new Weight Expression object by parsing the formula
+   *
+   * @param formula The formula to parse, e.g. "(weight_mc_NOSYS*weight_pileup_NOSYS)*(lumi*xSection/sumWeights_NOSYS)"
+   */
+  explicit WeightExpression(const std::string& formula);
+
+  /**
+   * @brief Destroy the Weight Expression object
+   *
+   */
+  ~WeightExpression() = default;
+
+  /**
+   * @brief Was the formula parsed successfully?
+   *
+   * @return true
+   * @return false
+   */
+  inline bool isValid() const {return m_isValid;}
+
+  /**
+   * @brief Get the columns of the product
+   *
+   * @return const std::vector<std::string>&
+   */
+  inline const std::vector<std::string>& columns() const {return m_columns;}
+
+  /**
+   * @brief Get the flags telling if the column is in the denominator
+   *
+   * @return const std::vector<bool>&
+   */
+  inline const std::vector<bool>& inverted() const {return m_inverted;}
+
+  /**
+   * @brief Get the numerical constant multiplying the product of the columns
+   *
+   * @return double
+   */
+  inline double constant() const {return m_constant;}
+
+  /**
+   * @brief Get the same expression with different columns, e.g. the columns replaced for a systematic variation.
+   * The formula is not parsed again
+   *
+   * @param columns The new columns, in the same order as columns()
+   * @param formula The formula corresponding to the new columns (used by the JIT fallback)
+   * @return WeightExpression
+   */
+  WeightExpression withColumns(const std::vector<std::string>& columns, const std::string& formula) const;
+
+  /**
+   * @brief Get the product of this expression and another one, the formula is "(this)*(other)"
+   *
+   * @param other The other expression
+   * @return WeightExpression
+   */
+  WeightExpression multiply(const WeightExpression& other) const;
+
+  /**
+   * @brief Can the formula be defined with the compiled functor on the given node?
+   * Requires a valid formula, all columns to exist with a supported arithmetic type,
+   * no division of integers and at most maxColumns columns
+   *
+   * @param node The node
+   * @return true
+   * @return false
+   */
+  bool isCompilable(ROOT::RDF::RNode node) const;
+
+  /**
+   * @brief Define the new column using the compiled functor.
+   * Columns that are not double are converted once (shared by all the weight expressions)
+   * Call isCompilable() first
+   *
+   * @param node The node
+   * @param name The name of the new column
+   * @return ROOT::RDF::RNode
+   */
+  ROOT::RDF::RNode define(ROOT::RDF::RNode node, const std::string& name) const;
+
+  /**
+   * @brief Maximum number of columns supported by the compiled functor
+   *
+   */
+  static constexpr std::size_t maxColumns = 24;
+
+private:
+
+  /**
+   * @brief Terms of a (sub)expression that decide whether it is an integer in C++
+   *
+   */
+  struct IntegerTerms {
+    // are all the numerical literals integers
+    bool literalsAreIntegers = true;
+    // indices of the columns, the expression is an integer if all of them have an integer type
+    std::vector<std::size_t> columns;
+  };
+
+  /**
+   * @brief Parse a product of factors, e.g. "a*b/c"
+   *
+   * @param position Current position in the formula, moved after the product
+   * @param inverted Is the product in a denominator
+   * @param terms Filled with the terms of the product
+   * @return true if successful
+   * @return false
+   */
+  bool parseProduct(std::size_t& position, const bool inverted, IntegerTerms* terms);
+
+  /**
+   * @brief Parse a single factor: a number, a column or a product in parentheses
+   *
+   * @param position Current position in the formula, moved after the factor
+   * @param inverted Is the factor in a denominator
+   * @param terms Filled with the terms of the factor
+   * @return true if successful
+   * @return false
+   */
+  bool parseFactor(std::size_t& position, const bool inverted, IntegerTerms* terms);
+
+  /**
+   * @brief Move the position after white spaces
+   *
+   * @param position Current position in the formula
+   */
+  void skipSpaces(std::size_t& position) const;
+
+  /**
+   * @brief Name of the column converted to double
+   *
+   * @param column The original column
+   * @return std::string
+   */
+  static std::string doubleColumnName(const std::string& column);
+
+  /**
+   * @brief Type alias used to repeat the double type in the parameter pack
+   *
+   */
+  template <std::size_t>
+  using RepeatedDouble = double;
+
+  /**
+   * @brief Define the product with a functor taking exactly N double arguments
+   *
+   * @tparam N Indices of the arguments
+   * @param node The node
+   * @param name Name of the new column
+   * @param columns Columns (of double type) used as the arguments
+   * @return ROOT::RDF::RNode
+   */
+  template <std::size_t... N>
+  ROOT::RDF::RNode defineProduct(ROOT::RDF::RNode node,
+                                 const std::string& name,
+                                 const std::vector<std::string>& columns,
+                                 std::index_sequence<N...>) const {
+
+    const double factor = m_constant;
+    const std::vector<bool> isInverted = m_inverted;
+    auto product = [factor, isInverted](RepeatedDouble<N>... args) {
+      const std::array<double, sizeof...(N)> values{args...};
+      double result = factor;
+      for (std::size_t i = 0; i < values.size(); ++i) {
+        result = isInverted[i] ? result/values[i] : result*values[i];
+      }
+      return result;
+    };
+
+    return node.Define(name, product, columns);
+  }
+
+  /**
+   * @brief Dispatch the number of the columns known at runtime to the compiled functor
+   *
+   * @tparam N Maximum number of the columns
+   * @param node The node
+   * @param name Name of the new column
+   * @param columns Columns (of double type) used as the arguments
+   * @return ROOT::RDF::RNode
+   */
+  template <std::size_t N>
+  ROOT::RDF::RNode dispatchProduct(ROOT::RDF::RNode node,
+                                   const std::string& name,
+                                   const std::vector<std::string>& columns) const {
+
+    if (columns.size() == N) {
+      return this->defineProduct(node, name, columns, std::make_index_sequence<N>());
+    }
+    if constexpr (N > 0) {
+      return this->dispatchProduct<N-1>(node, name, columns);
+    } else {
+      return node.Define(name, m_formula);
+    }
+  }
+
+  std::string m_formula;
+  bool m_isValid;
+  std::vector<std::string> m_columns;
+  std::vector<bool> m_inverted;
+  double m_constant;
+  // columns of the divisions whose both sides have only integer literals,
+  // these are integer divisions if all the columns have an integer type
+  std::vector<std::vector<std::size_t> > m_integerDivisions;
+};
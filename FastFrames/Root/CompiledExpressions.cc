@@ -0,0 +1,318 @@
+/**
+ * @file CompiledExpressions.cc
+ * @brief Registry of ahead-of-time compiled filters and defines and the generator of their source code
+ *
+ */
+
+#include "FastFrames/CompiledExpressions.h"
+
+#include "FastFrames/JitCache.h"
+#include "FastFrames/Logger.h"
+#include "FastFrames/StringOperations.h"
+
+#include "TSystem.h"
+
+#include <algorithm>
+#include <exception>
+#include <fstream>
+#include <sstream>
+
+namespace {
+    /**
+     * @brief Escape the backslashes and the new lines, so the text fits a single line comment
+     *
+     * @param text
+     * @return std::string
+     */
+    std::string escapeComment(const std::string& text) {
+        std::string result;
+        for (const char c : text) {
+            if (c == '\\')      result += "\\\\";
+            else if (c == '\n') result += "\\n";
+            else                result += c;
+        }
+
+        return result;
+    }
+
+    /**
+     * @brief Inverse of escapeComment()
+     *
+     * @param text
+     * @return std::string
+     */
+    std::string unescapeComment(const std::string& text) {
+        std::string result;
+        for (std::size_t i = 0; i < text.size(); ++i) {
+            if (text.at(i) == '\\' && i + 1 < text.size()) {
+                ++i;
+                result += text.at(i) == 'n' ? '\n' : text.at(i);
+            } else {
+                result += text.at(i);
+            }
+        }
+
+        return result;
+    }
+}
+
+CompiledExpressions& CompiledExpressions::instance() {
+    static CompiledExpressions expressions;
+    return expressions;
+}
+
+void CompiledExpressions::addFilter(const std::string& key, FilterFunction function) {
+    m_filters[key] = std::move(function);
+}
+
+void CompiledExpressions::addDefine(const std::string& key, DefineFunction function) {
+    m_defines[key] = std::move(function);
+}
+
+bool CompiledExpressions::filter(ROOT::RDF::RNode node, const std::string& expression, ROOT::RDF::RNode* result) {
+    std::vector<std::pair<std::string, std::string> > columns;
+    if (!JitCache::usedColumns(node, expression, &columns)) return false;
+
+    const std::string key = CompiledExpressions::key(expression, columns, true);
+    auto itr = m_filters.find(key);
+    this->record(key, expression, columns, true, itr != m_filters.end());
+    if (itr == m_filters.end()) return false;
+
+    LOG(VERBOSE) << "Using compiled filter for: " << expression << "\n";
+    *result = itr->second(node);
+
+    return true;
+}
+
+bool CompiledExpressions::define(ROOT::RDF::RNode node,
+                                 const std::string& name,
+                                 const std::string& expression,
+                                 const bool isRedefine,
+                                 ROOT::RDF::RNode* result) {
+
+    std::vector<std::pair<std::string, std::string> > columns;
+    if (!JitCache::usedColumns(node, expression, &columns)) return false;
+
+    const std::string key = CompiledExpressions::key(expression, columns, false);
+    auto itr = m_defines.find(key);
+    this->record(key, expression, columns, false, itr != m_defines.end());
+    if (itr == m_defines.end()) return false;
+
+    LOG(VERBOSE) << "Using compiled define for: " << name << ", expression: " << expression << "\n";
+    *result = itr->second(node, name, isRedefine);
+
+    return true;
+}
+
+void CompiledExpressions::record(const std::string& key,
+                                 const std::string& expression,
+                                 const std::vector<std::pair<std::string, std::string> >& columns,
+                                 const bool isFilter,
+                                 const bool isCompiled) {
+
+    if (m_failed.find(key) != m_failed.end()) return;
+    if (!isCompiled) m_hasMissing = true;
+    if (m_records.find(key) != m_records.end()) return;
+
+    m_records.insert({key, Record{expression, columns, isFilter}});
+}
+
+void CompiledExpressions::readFailedExpressions(const std::string& path) {
+    std::ifstream in(path + ".failed");
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.empty()) continue;
+        m_failed.insert(line);
+    }
+    if (!m_failed.empty()) {
+        LOG(INFO) << m_failed.size() << " expressions could not be compiled ahead of time in the previous runs, they will be JIT compiled\n";
+    }
+}
+
+void CompiledExpressions::writeSource(const std::string& path) {
+    // keep the expressions of the previous runs, e.g. with other steps or samples
+    this->readRecords(path);
+
+    std::vector<std::string> keys;
+    for (const auto& irecord : m_records) {
+        keys.emplace_back(irecord.first);
+    }
+
+    std::vector<std::string> failedKeys;
+    if (!this->compiles(keys)) {
+        // the expressions are not the problem (e.g. missing headers or compiler), no need to bisect them
+        if (!this->compiles({})) {
+            LOG(WARNING) << "Cannot compile the generated code even without any expressions, not writing: " << path << "\n";
+            return;
+        }
+        this->findFailingRecords(keys, 0, &failedKeys);
+    }
+
+    if (!failedKeys.empty()) {
+        std::ofstream failed(path + ".failed", std::ios::app);
+        for (const auto& ikey : failedKeys) {
+            LOG(WARNING) << "Cannot compile the expression: " << m_records.at(ikey).expression << ", it will be JIT compiled\n";
+            failed << ikey << "\n";
+            m_failed.insert(ikey);
+        }
+        keys.erase(std::remove_if(keys.begin(), keys.end(), [this](const std::string& key){
+            return m_failed.find(key) != m_failed.end();
+        }), keys.end());
+    }
+
+    this->writeRecords(path, keys);
+    LOG(INFO) << "Written " << keys.size() << " expressions to: " << path << "\n";
+}
+
+void CompiledExpressions::readRecords(const std::string& path) {
+    std::ifstream in(path);
+    if (!in.good()) return;
+
+    static const std::string filterTag  = "    // filter: ";
+    static const std::string defineTag  = "    // define: ";
+    static const std::string columnsTag = "    // columns: ";
+
+    std::size_t nRecords(0);
+    std::string expression;
+    bool isFilter(false);
+    bool hasExpression(false);
+    std::string line;
+    while (std::getline(in, line)) {
+        if (StringOperations::stringStartsWith(line, filterTag) || StringOperations::stringStartsWith(line, defineTag)) {
+            isFilter = StringOperations::stringStartsWith(line, filterTag);
+            expression = unescapeComment(line.substr(filterTag.size()));
+            hasExpression = true;
+            continue;
+        }
+        if (!hasExpression || !StringOperations::stringStartsWith(line, columnsTag)) continue;
+        hasExpression = false;
+
+        std::vector<std::pair<std::string, std::string> > columns;
+        for (const auto& icolumn : StringOperations::splitString(line.substr(columnsTag.size()), ";")) {
+            if (icolumn.empty()) continue;
+            const std::size_t separator = icolumn.find(':');
+            if (separator == std::string::npos) continue;
+            columns.emplace_back(icolumn.substr(0, separator), icolumn.substr(separator + 1));
+        }
+
+        const std::string key = CompiledExpressions::key(expression, columns, isFilter);
+        if (m_failed.find(key) != m_failed.end()) continue;
+        if (m_records.find(key) != m_records.end()) continue;
+        m_records.insert({key, Record{expression, columns, isFilter}});
+        ++nRecords;
+    }
+
+    LOG(DEBUG) << "Read " << nRecords << " expressions of the previous runs from: " << path << "\n";
+}
+
+bool CompiledExpressions::compiles(const std::vector<std::string>& keys) const {
+    // a unique temporary file per set of expressions, only compiled, not loaded
+    std::string names;
+    for (const auto& ikey : keys) {
+        names += ikey;
+    }
+    std::ostringstream path;
+    path << gSystem->TempDirectory() << "/FastFramesCompiledExpressions_" << gSystem->GetPid() << "_" << std::hex << JitCache::hash(names) << ".C";
+
+    this->writeRecords(path.str(), keys);
+    const bool isCompiled = gSystem->CompileMacro(path.str().c_str(), "c", "", gSystem->TempDirectory()) == 1;
+    gSystem->Unlink(path.str().c_str());
+
+    return isCompiled;
+}
+
+void CompiledExpressions::findFailingRecords(const std::vector<std::string>& keys,
+                                             const std::size_t depth,
+                                             std::vector<std::string>* failedKeys) const {
+
+    if (keys.size() == 1 || depth >= maxBisectionDepth) {
+        failedKeys->insert(failedKeys->end(), keys.begin(), keys.end());
+        return;
+    }
+
+    const auto middle = keys.begin() + keys.size() / 2;
+    for (const auto& ipart : {std::vector<std::string>(keys.begin(), middle), std::vector<std::string>(middle, keys.end())}) {
+        if (this->compiles(ipart)) continue;
+        this->findFailingRecords(ipart, depth + 1, failedKeys);
+    }
+}
+
+void CompiledExpressions::writeRecords(const std::string& path, const std::vector<std::string>& keys) const {
+    std::ofstream out(path);
+    if (!out.good()) {
+        LOG(ERROR) << "Cannot open: " << path << " to write the generated code\n";
+        throw std::invalid_argument("");
+    }
+
+    out << "// Generated by FastFrames from the configuration, do not edit\n";
+    out << "#include \"FastFrames/CompiledExpressions.h\"\n";
+    out << "#include \"FastFrames/DefineHelpers.h\"\n\n";
+    out << "#include \"Math/Vector4D.h\"\n";
+    out << "#include \"ROOT/RDataFrame.hxx\"\n";
+    out << "#include \"ROOT/RVec.hxx\"\n\n";
+    out << "#include <cmath>\n";
+    out << "#include <string>\n";
+    out << "#include <vector>\n\n";
+    out << "using namespace ROOT::VecOps;\n\n";
+    out << "namespace {\n\n";
+    out << "bool registerCompiledExpressions() {\n";
+    out << "    CompiledExpressions& expressions = CompiledExpressions::instance();\n";
+
+    for (const auto& ikey : keys) {
+        const Record& record = m_records.at(ikey);
+
+        std::string arguments;
+        std::string columnNames;
+        for (const auto& icolumn : record.columns) {
+            std::string type = icolumn.second;
+            if (StringOperations::stringStartsWith(type, "vector<")) type = "std::" + type;
+            arguments += (arguments.empty() ? "" : ", ") + ("const " + type + "& " + icolumn.first);
+            columnNames += (columnNames.empty() ? "\"" : ", \"") + icolumn.first + "\"";
+        }
+
+        // same convention as RDataFrame: expressions with a return statement are used as the function body
+        const std::string body = StringOperations::contains(record.expression, "return ") ?
+                                 record.expression : "return " + record.expression + ";";
+
+        // the expression and the columns are read back when the file is regenerated
+        out << "\n    // " << (record.isFilter ? "filter: " : "define: ") << escapeComment(record.expression) << "\n";
+        out << "    // columns: ";
+        for (const auto& icolumn : record.columns) {
+            out << icolumn.first << ":" << icolumn.second << ";";
+        }
+        out << "\n";
+        if (record.isFilter) {
+            out << "    expressions.addFilter(\"" << ikey << "\", [](ROOT::RDF::RNode node) {\n";
+            out << "        auto function = [](" << arguments << ") -> bool {" << body << "};\n";
+            out << "        return ROOT::RDF::RNode(node.Filter(function, {" << columnNames << "}));\n";
+        } else {
+            out << "    expressions.addDefine(\"" << ikey << "\", [](ROOT::RDF::RNode node, const std::string& name, const bool isRedefine) {\n";
+            out << "        auto function = [](" << arguments << ") {" << body << "};\n";
+            out << "        return isRedefine ? ROOT::RDF::RNode(node.Redefine(name, function, {" << columnNames << "})) :\n";
+            out << "                            ROOT::RDF::RNode(node.Define(name, function, {" << columnNames << "}));\n";
+        }
+        out << "    });\n";
+    }
+
+    out << "\n    return true;\n";
+    out << "}\n\n";
+    out << "[[maybe_unused]] const bool isRegistered = registerCompiledExpressions();\n\n";
+    out << "}\n";
+
+    LOG(DEBUG) << "Written " << keys.size() << " expressions to: " << path << "\n";
+}
+
+std::string CompiledExpressions::key(const std::string& expression,
+                                     const std::vector<std::pair<std::string, std::string> >& columns,
+                                     const bool isFilter) {
+
+    std::string text = (isFilter ? "filter\n" : "define\n") + expression + "\n";
+    for (const auto& icolumn : columns) {
+        text += icolumn.first + ":" + icolumn.second + ";";
+    }
+
+    std::ostringstream result;
+    result << std::hex << JitCache::hash(text);
+
+    return result.str();
+}
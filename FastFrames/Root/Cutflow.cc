@@ -6,6 +6,7 @@
 #include "FastFrames/Cutflow.h"
 
 Cutflow::Cutflow(const std::string& name) noexcept :
-m_name(name)
+m_name(name),
+m_systematics(false)
 {
 }
@@ -11,12 +11,8 @@ m_name(name)
 
 void CutflowContainer::copyValues(CutflowContainer& other) {
     m_titles = other.m_titles;
-    for (auto& value : other.m_bookedYields) {
-        m_yields.emplace_back(value.GetValue());
-    }
-    for (auto& value : other.m_bookedYieldErrors) {
-        m_yieldErrors.emplace_back(value.GetValue());
-    }
+    m_systematicNames = other.m_systematicNames;
+    other.bookedValues(&m_yields, &m_yieldErrors);
 }
 
 void CutflowContainer::mergeValues(CutflowContainer& other) {
@@ -25,24 +21,56 @@ void CutflowContainer::mergeValues(CutflowContainer& other) {
         throw std::runtime_error("");
     }
 
-    if (m_yields.size() != other.m_bookedYields.size()) {
+    if (m_systematicNames != other.m_systematicNames) {
+        LOG(ERROR) << "Incompatible systematics\n";
+        throw std::runtime_error("");
+    }
+
+    std::vector<double> yields;
+    std::vector<double> yieldErrors;
+    other.bookedValues(&yields, &yieldErrors);
+
+    if (m_yields.size() != yields.size()) {
         LOG(ERROR) << "Incompatible size of yields\n";
         throw std::runtime_error("");
     }
 
-    if (m_yieldErrors.size() != other.m_bookedYieldErrors.size()) {
+    if (m_yieldErrors.size() != yieldErrors.size()) {
         LOG(ERROR) << "Incompatible size of errors\n";
         throw std::runtime_error("");
     }
 
     for (std::size_t i = 0; i < m_yields.size(); ++i) {
-        m_yields.at(i)      += other.m_bookedYields.at(i).GetValue();
-        m_yieldErrors.at(i) += other.m_bookedYieldErrors.at(i).GetValue();
+        m_yields.at(i)      += yields.at(i);
+        m_yieldErrors.at(i) += yieldErrors.at(i);
+    }
+}
+
+void CutflowContainer::mergeCopiedValues(const CutflowContainer& other) {
+    if (m_titles.size() != other.m_titles.size()) {
+        LOG(ERROR) << "Incompatible size of titles\n";
+        throw std::runtime_error("");
+    }
+
+    if (m_systematicNames != other.m_systematicNames) {
+        LOG(ERROR) << "Incompatible systematics\n";
+        throw std::runtime_error("");
+    }
+
+    if (m_yields.size() != other.m_yields.size() || m_yieldErrors.size() != other.m_yieldErrors.size()) {
+        LOG(ERROR) << "Incompatible size of yields\n";
+        throw std::runtime_error("");
+    }
+
+    for (std::size_t i = 0; i < m_yields.size(); ++i) {
+        m_yields.at(i)      += other.m_yields.at(i);
+        m_yieldErrors.at(i) += other.m_yieldErrors.at(i);
     }
 }
 
 std::unique_ptr<TH1D> CutflowContainer::cutflowHisto() const {
-    const int nbins = m_yields.size();
+    // the nominal values are stored first
+    const int nbins = m_titles.size();
     std::unique_ptr<TH1D> h = std::make_unique<TH1D>("","", nbins, 0, nbins);
 
     for (int ibin = 1; ibin <= nbins; ++ibin) {
@@ -59,16 +87,10 @@ std::unique_ptr<TH1D> CutflowContainer::cutflowHisto() const {
 std::unique_ptr<TH1D> CutflowContainer::cutflowHistoExecute() {
     std::vector<double> yields;
     std::vector<double> yieldErrors;
+    this->bookedValues(&yields, &yieldErrors);
 
-    for (auto& value : m_bookedYields) {
-        yields.emplace_back(value.GetValue());
-    }
-
-    for (auto& error : m_bookedYieldErrors) {
-        yieldErrors.emplace_back(error.GetValue());
-    }
-
-    const int nbins = yields.size();
+    // the nominal values are stored first
+    const int nbins = m_titles.size();
     std::unique_ptr<TH1D> h = std::make_unique<TH1D>("","", nbins, 0, nbins);
 
     for (int ibin = 1; ibin <= nbins; ++ibin) {
@@ -80,4 +102,48 @@ std::unique_ptr<TH1D> CutflowContainer::cutflowHistoExecute() {
     h->SetDirectory(nullptr);
 
     return h;
-}
\ No newline at end of file
+}
+std::unique_ptr<TH2D> CutflowContainer::systematicCutflowHisto() const {
+    const int nbinsX = m_titles.size();
+    const int nbinsY = m_systematicNames.size();
+    if (m_yields.size() != static_cast<std::size_t>(nbinsX * nbinsY)) {
+        LOG(ERROR) << "Incompatible size of the systematic cutflow yields\n";
+        throw std::runtime_error("");
+    }
+
+    std::unique_ptr<TH2D> h = std::make_unique<TH2D>("","", nbinsX, 0, nbinsX, nbinsY, 0, nbinsY);
+
+    for (int ibinY = 1; ibinY <= nbinsY; ++ibinY) {
+        for (int ibinX = 1; ibinX <= nbinsX; ++ibinX) {
+            const std::size_t index = (ibinY - 1) * nbinsX + ibinX - 1;
+            h->SetBinContent(ibinX, ibinY, m_yields.at(index));
+            h->SetBinError  (ibinX, ibinY, std::sqrt(m_yieldErrors.at(index)));
+        }
+        h->GetYaxis()->SetBinLabel(ibinY, m_systematicNames.at(ibinY - 1).c_str());
+    }
+    for (int ibinX = 1; ibinX <= nbinsX; ++ibinX) {
+        h->GetXaxis()->SetBinLabel(ibinX, m_titles.at(ibinX - 1).c_str());
+    }
+
+    h->SetDirectory(nullptr);
+
+    return h;
+}
+
+void CutflowContainer::bookedValues(std::vector<double>* yields, std::vector<double>* errors) {
+    for (auto& value : m_bookedYields) {
+        yields->emplace_back(value.GetValue());
+    }
+
+    for (auto& error : m_bookedYieldErrors) {
+        errors->emplace_back(error.GetValue());
+    }
+
+    if (!m_bookedSums) return;
+
+    // the sums of weights of all steps are followed by the sums of squared weights
+    const std::vector<double>& sums = *m_bookedSums;
+    const std::size_t nSteps = sums.size() / 2;
+    yields->insert(yields->end(), sums.begin(), sums.begin() + nSteps);
+    errors->insert(errors->end(), sums.begin() + nSteps, sums.end());
+}
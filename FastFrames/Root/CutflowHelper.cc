@@ -0,0 +1,76 @@
+/**
+ * @file CutflowHelper.cc
+ * @brief Custom RDataFrame action accumulating all steps of a cutflow at once
+ *
+ */
+
+#include "FastFrames/CutflowHelper.h"
+
+#include "FastFrames/Logger.h"
+
+#include <algorithm>
+#include <exception>
+
+namespace {
+  // number of doubles in a cache line
+  constexpr std::size_t cacheLineDoubles = 8;
+}
+
+CutflowHelper::CutflowHelper(const std::size_t nSteps,
+                             const unsigned int nSlots,
+                             const std::size_t nVariations) :
+m_result(std::make_shared<Result_t>()),
+m_nSteps(nSteps),
+m_nVariations(nVariations),
+m_slotStride(((2 * nSteps * nVariations + cacheLineDoubles - 1) / cacheLineDoubles) * cacheLineDoubles),
+m_perSlotSums(m_slotStride * nSlots, 0.)
+{
+}
+
+void CutflowHelper::Exec(unsigned int slot, const int nPassed, const double weight) {
+    double* sums = m_perSlotSums.data() + slot * m_slotStride;
+    double* sumsSquared = sums + m_nSteps * m_nVariations;
+    const double weightSquared = weight * weight;
+
+    const std::size_t n = std::min<std::size_t>(std::max(nPassed, 0), m_nSteps);
+    for (std::size_t istep = 0; istep < n; ++istep) {
+        sums[istep]        += weight;
+        sumsSquared[istep] += weightSquared;
+    }
+}
+
+void CutflowHelper::Exec(unsigned int slot,
+                         const ROOT::VecOps::RVec<int>& nPassed,
+                         const ROOT::VecOps::RVec<double>& weights) {
+
+    double* sums = m_perSlotSums.data() + slot * m_slotStride;
+    double* sumsSquared = sums + m_nSteps * m_nVariations;
+
+    for (std::size_t ivariation = 0; ivariation < m_nVariations; ++ivariation) {
+        const double weight = weights[ivariation];
+        const double weightSquared = weight * weight;
+        const std::size_t offset = ivariation * m_nSteps;
+        const std::size_t n = std::min<std::size_t>(std::max(nPassed[ivariation], 0), m_nSteps);
+        for (std::size_t istep = 0; istep < n; ++istep) {
+            sums[offset + istep]        += weight;
+            sumsSquared[offset + istep] += weightSquared;
+        }
+    }
+}
+
+void CutflowHelper::Finalize() {
+    if (m_perSlotSums.empty()) {
+        LOG(ERROR) << "No processing slots available for the cutflow\n";
+        throw std::runtime_error("");
+    }
+
+    const std::size_t size = 2 * m_nSteps * m_nVariations;
+    m_result->assign(m_perSlotSums.begin(), m_perSlotSums.begin() + size);
+    for (std::size_t islot = m_slotStride; islot < m_perSlotSums.size(); islot += m_slotStride) {
+        for (std::size_t i = 0; i < size; ++i) {
+            m_result->at(i) += m_perSlotSums.at(islot + i);
+        }
+    }
+
+    m_perSlotSums.clear();
+}
@@ -6,6 +6,7 @@
 
 #include "FastFrames/FastFramesExecutor.h"
 
+#include "FastFrames/CompiledExpressions.h"
 #include "FastFrames/ConfigSetting.h"
 #include "FastFrames/Logger.h"
 #include "FastFrames/MainFrame.h"
@@ -49,6 +50,21 @@ void FastFramesExecutor::runFastFrames() const {
       baseFrame = std::make_unique<MainFrame>();
     }
 
+    // load the expressions compiled ahead of time, they register themselves when the library is loaded
+    const std::string& compiledCodePath = m_config->compiledCodePath();
+    if (!compiledCodePath.empty()) {
+      CompiledExpressions::instance().readFailedExpressions(compiledCodePath);
+    }
+    if (!compiledCodePath.empty() && !gSystem->AccessPathName(compiledCodePath.c_str())) {
+      LOG(INFO) << "Loading the compiled expressions from: " << compiledCodePath << "\n";
+      const std::string previousFlags = gSystem->GetFlagsOpt();
+      gSystem->SetFlagsOpt("-O3");
+      if (gSystem->CompileMacro(compiledCodePath.c_str(), "kO") != 1) {
+        LOG(WARNING) << "Cannot compile: " << compiledCodePath << ", the expressions will be JIT compiled\n";
+      }
+      gSystem->SetFlagsOpt(previousFlags.c_str());
+    }
+
     baseFrame->setConfig(m_config);
 
     baseFrame->init();
@@ -8,6 +8,7 @@
 
 #include "FastFrames/Logger.h"
 
+#include <algorithm>
 #include <exception>
 
 void VariableHisto::mergeHisto(ROOT::RDF::RResultPtr<TH1D> h) {
@@ -21,11 +22,42 @@ void VariableHisto2D::mergeHisto(ROOT::RDF::RResultPtr<TH2D> h) {
 void VariableHisto3D::mergeHisto(ROOT::RDF::RResultPtr<TH3D> h) {
     m_histoUniquePtr->Add(h.GetPtr());
 }
+
+void VariableHisto::mergeHisto(const std::unique_ptr<TH1D>& h) {
+    m_histoUniquePtr->Add(h.get());
+}
+
+void VariableHisto::mergeHisto(const TH1D* h) {
+    m_histoUniquePtr->Add(h);
+}
+
+void VariableHisto2D::mergeHisto(const std::unique_ptr<TH2D>& h) {
+    m_histoUniquePtr->Add(h.get());
+}
+
+void VariableHisto3D::mergeHisto(const std::unique_ptr<TH3D>& h) {
+    m_histoUniquePtr->Add(h.get());
+}
   
 void VariableHisto::copyHisto(ROOT::RDF::RResultPtr<TH1D> h) {
     m_histoUniquePtr.reset(static_cast<TH1D*>(h->Clone()));
 }
 
+void VariableHisto::copyHisto(const TH1D* h) {
+    m_histoUniquePtr.reset(static_cast<TH1D*>(h->Clone()));
+}
+
+const TH1D* VariableHisto::histoPtr() const {
+    if (m_packedHistos) {
+        // the result is owned by RDF, the copy of the RResultPtr only keeps it alive
+        auto packed = m_packedHistos;
+        return &packed->at(m_packedIndex);
+    }
+
+    auto histo = m_histo;
+    return histo.GetPtr();
+}
+
 void VariableHisto2D::copyHisto(ROOT::RDF::RResultPtr<TH2D> h) {
     m_histoUniquePtr.reset(static_cast<TH2D*>(h->Clone()));
 }
@@ -34,7 +66,7 @@ void VariableHisto3D::copyHisto(ROOT::RDF::RResultPtr<TH3D> h) {
     m_histoUniquePtr.reset(static_cast<TH3D*>(h->Clone()));
 }
 
-void SystematicHisto::merge(const SystematicHisto& other) {
+void SystematicHisto::checkCompatibility(const SystematicHisto& other) const {
     if (m_name != other.name()) {
         LOG(ERROR) << "Something went wrong with the merging of the histograms\n";
         throw std::runtime_error("");
@@ -54,11 +86,21 @@ void SystematicHisto::merge(const SystematicHisto& other) {
             LOG(ERROR) << "Sizes of the 2D variables do not match!\n";
             throw std::runtime_error("");
         }
+        if (m_regions.at(ireg).variableHistos3D().size() != other.m_regions.at(ireg).variableHistos3D().size()) {
+            LOG(ERROR) << "Sizes of the 3D variables do not match!\n";
+            throw std::runtime_error("");
+        }
+    }
+}
 
+void SystematicHisto::merge(const SystematicHisto& other) {
+    this->checkCompatibility(other);
+
+    for (std::size_t ireg = 0; ireg < m_regions.size(); ++ireg) {
         // merge 1D histos
         for (std::size_t ivariable = 0; ivariable < m_regions.at(ireg).variableHistos().size(); ++ivariable) {
             m_regions.at(ireg).variableHistos().at(ivariable)
-                     .mergeHisto(other.regionHistos().at(ireg).variableHistos().at(ivariable).histo());
+                     .mergeHisto(other.regionHistos().at(ireg).variableHistos().at(ivariable).histoPtr());
         }
 
         // merge 2D histos
@@ -81,7 +123,7 @@ SystematicHisto SystematicHisto::copy() const {
         result.m_regions.emplace_back(RegionHisto(ireg.name()));
         for (const auto& ivariable : ireg.variableHistos()) {
             result.m_regions.back().variableHistos().emplace_back(ivariable.name());
-            result.m_regions.back().variableHistos().back().copyHisto(ivariable.histo());
+            result.m_regions.back().variableHistos().back().copyHisto(ivariable.histoPtr());
         }
         for (const auto& ivariable : ireg.variableHistos2D()) {
             result.m_regions.back().variableHistos2D().emplace_back(ivariable.name());
@@ -94,4 +136,52 @@ SystematicHisto SystematicHisto::copy() const {
     }
 
     return result;
-}
\ No newline at end of file
+}
+
+void SystematicHisto::mergeCopy(const SystematicHisto& other) {
+    this->checkCompatibility(other);
+
+    for (std::size_t ireg = 0; ireg < m_regions.size(); ++ireg) {
+        for (std::size_t ivariable = 0; ivariable < m_regions.at(ireg).variableHistos().size(); ++ivariable) {
+            m_regions.at(ireg).variableHistos().at(ivariable)
+                     .mergeHisto(other.regionHistos().at(ireg).variableHistos().at(ivariable).histoUniquePtr());
+        }
+
+        for (std::size_t ivariable2D = 0; ivariable2D < m_regions.at(ireg).variableHistos2D().size(); ++ivariable2D) {
+            m_regions.at(ireg).variableHistos2D().at(ivariable2D)
+                     .mergeHisto(other.regionHistos().at(ireg).variableHistos2D().at(ivariable2D).histoUniquePtr());
+        }
+
+        for (std::size_t ivariable3D = 0; ivariable3D < m_regions.at(ireg).variableHistos3D().size(); ++ivariable3D) {
+            m_regions.at(ireg).variableHistos3D().at(ivariable3D)
+                     .mergeHisto(other.regionHistos().at(ireg).variableHistos3D().at(ivariable3D).histoUniquePtr());
+        }
+    }
+}
+
+void PackedHistoContainer::addHistos(const std::string& region,
+                                     const std::string& variable,
+                                     const ROOT::RDF::RResultPtr<std::vector<TH1D> >& histos,
+                                     const std::vector<std::string>& systematics) {
+
+    m_histos[std::make_pair(region, variable)].emplace_back(histos, systematics);
+}
+
+bool PackedHistoContainer::setPackedHisto(VariableHisto* histo,
+                                          const std::string& region,
+                                          const std::string& systematic) const {
+
+    auto itr = m_histos.find(std::make_pair(region, histo->name()));
+    if (itr == m_histos.end()) return false;
+
+    for (const auto& ipacked : itr->second) {
+        auto itrSyst = std::find(ipacked.second.begin(), ipacked.second.end(), systematic);
+        if (itrSyst == ipacked.second.end()) continue;
+
+        histo->setPackedHisto(ipacked.first, std::distance(ipacked.second.begin(), itrSyst));
+        return true;
+    }
+
+    return false;
+}
+
@@ -0,0 +1,387 @@
+/**
+ * @file JitCache.cc
+ * @brief On-disk cache of compiled string expressions used in RDataFrame
+ *
+ */
+
+#include "FastFrames/JitCache.h"
+
+#include "FastFrames/Logger.h"
+#include "FastFrames/StringOperations.h"
+
+#include "RVersion.h"
+#include "TSystem.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+JitCache::JitCache(const std::string& directory) :
+m_directory(directory)
+{
+}
+
+void JitCache::load() {
+    void* directory = gSystem->OpenDirectory(m_directory.c_str());
+    if (!directory) {
+        LOG(INFO) << "JIT cache directory: " << m_directory << " does not exist yet, it will be created at the end of the run\n";
+        return;
+    }
+
+    const std::string prefix = this->filePrefix();
+    std::vector<std::string> sources;
+    while (const char* entry = gSystem->GetDirEntry(directory)) {
+        const std::string name(entry);
+        if (StringOperations::stringStartsWith(name, prefix) && StringOperations::stringEndsWith(name, ".C")) {
+            sources.emplace_back(m_directory + "/" + name);
+        }
+    }
+    gSystem->FreeDirectory(directory);
+
+    // functions that could not be compiled in the previous runs
+    std::ifstream failed(m_directory + "/" + prefix + "failed.txt");
+    std::string line;
+    while (std::getline(failed, line)) {
+        if (line.empty()) continue;
+        m_failed.insert(line);
+    }
+
+    // the libraries register their functions when they are loaded
+    for (const auto& isource : sources) {
+        // ACLiC only loads the library if it is up to date
+        if (gSystem->CompileMacro(isource.c_str(), "kO", "", m_directory.c_str()) != 1) {
+            LOG(WARNING) << "Cannot load the JIT cache from: " << isource << ", ignoring it\n";
+        }
+    }
+
+    LOG(INFO) << "Loaded " << JitCache::filters().size() + JitCache::defines().size() << " compiled expressions from the JIT cache: " << m_directory << "\n";
+}
+
+bool JitCache::filter(ROOT::RDF::RNode node,
+                      const std::string& expression,
+                      ROOT::RDF::RNode* result) const {
+
+    std::vector<std::pair<std::string, std::string> > columns;
+    if (!JitCache::usedColumns(node, expression, &columns)) return false;
+
+    const std::string name = this->functionName(expression, columns, true);
+    auto itr = JitCache::filters().find(name);
+    if (itr == JitCache::filters().end()) return false;
+
+    LOG(VERBOSE) << "Using compiled function: " << name << " for selection: " << expression << "\n";
+    *result = itr->second(node);
+
+    return true;
+}
+
+bool JitCache::define(ROOT::RDF::RNode node,
+                      const std::string& name,
+                      const std::string& expression,
+                      const bool isRedefine,
+                      ROOT::RDF::RNode* result) const {
+
+    std::vector<std::pair<std::string, std::string> > columns;
+    if (!JitCache::usedColumns(node, expression, &columns)) return false;
+
+    const std::string functionName = this->functionName(expression, columns, false);
+    auto itr = JitCache::defines().find(functionName);
+    if (itr == JitCache::defines().end()) return false;
+
+    LOG(VERBOSE) << "Using compiled function: " << functionName << " for column: " << name << ", expression: " << expression << "\n";
+    *result = itr->second(node, name, isRedefine);
+
+    return true;
+}
+
+void JitCache::addExpression(ROOT::RDF::RNode node,
+                             const std::string& expression,
+                             const std::string& returnType,
+                             const bool isFilter) {
+
+    // types that cannot be spelled (e.g. lambdas) cannot be cached
+    if (returnType.empty() || StringOperations::contains(returnType, "lambda")) return;
+
+    std::vector<std::pair<std::string, std::string> > columns;
+    if (!JitCache::usedColumns(node, expression, &columns)) return;
+
+    const std::string name = this->functionName(expression, columns, isFilter);
+    if (JitCache::filters().find(name) != JitCache::filters().end()) return;
+    if (JitCache::defines().find(name) != JitCache::defines().end()) return;
+    if (m_failed.find(name) != m_failed.end()) return;
+    if (m_newFunctions.find(name) != m_newFunctions.end()) return;
+
+    auto spelledType = [](const std::string& type) {
+        return StringOperations::stringStartsWith(type, "vector<") ? "std::" + type : type;
+    };
+
+    std::string arguments;
+    std::string columnNames;
+    for (const auto& icolumn : columns) {
+        arguments += (arguments.empty() ? "" : ", ") + ("const " + spelledType(icolumn.second) + "& " + icolumn.first);
+        columnNames += (columnNames.empty() ? "\"" : ", \"") + icolumn.first + "\"";
+    }
+
+    // the functions are only used through the registered Filter/Define, no need for external linkage
+    std::string source = "namespace {\n\n";
+    source += (isFilter ? "bool" : spelledType(returnType)) + " " + name + "(" + arguments + ") {\n";
+    // same convention as RDataFrame: expressions with a return statement are used as the function body
+    if (StringOperations::contains(expression, "return ")) {
+        source += "    " + expression + "\n";
+    } else {
+        source += "    return " + expression + ";\n";
+    }
+    source += "}\n\n";
+    if (isFilter) {
+        source += "[[maybe_unused]] const bool isRegistered_" + name + " = JitCache::registerFilter(\"" + name + "\", [](ROOT::RDF::RNode node) {\n";
+        source += "    return ROOT::RDF::RNode(node.Filter(" + name + ", {" + columnNames + "}));\n";
+    } else {
+        source += "[[maybe_unused]] const bool isRegistered_" + name + " = JitCache::registerDefine(\"" + name + "\", [](ROOT::RDF::RNode node, const std::string& column, const bool isRedefine) {\n";
+        source += "    return isRedefine ? ROOT::RDF::RNode(node.Redefine(column, " + name + ", {" + columnNames + "})) :\n";
+        source += "                        ROOT::RDF::RNode(node.Define(column, " + name + ", {" + columnNames + "}));\n";
+    }
+    source += "});\n\n";
+    source += "}\n";
+
+    m_newFunctions.emplace(name, std::move(source));
+}
+
+void JitCache::write() {
+    if (m_newFunctions.empty()) return;
+
+    gSystem->mkdir(m_directory.c_str(), true);
+
+    const std::vector<std::pair<std::string, std::string> > functions(m_newFunctions.begin(), m_newFunctions.end());
+    LOG(INFO) << "Compiling " << functions.size() << " expressions into the JIT cache: " << m_directory << "\n";
+
+    std::vector<std::string> failedNames;
+    if (!this->writeAndCompile(functions)) {
+        // the functions are not the problem (e.g. missing headers or compiler), no need to bisect them
+        if (!this->compilesWithoutFunctions()) {
+            LOG(WARNING) << "Cannot compile the JIT cache files even without any expressions, the expressions are not cached\n";
+            m_newFunctions.clear();
+            return;
+        }
+        this->compileFunctions(functions, 0, &failedNames);
+    }
+
+    if (!failedNames.empty()) {
+        // the prefix contains the ROOT version, the functions are retried with a different version
+        std::ofstream failed(m_directory + "/" + this->filePrefix() + "failed.txt", std::ios::app);
+        for (const auto& iname : failedNames) {
+            LOG(WARNING) << "Cannot compile the expression of function: " << iname << ", it will not be cached\n";
+            failed << iname << "\n";
+            m_failed.insert(iname);
+        }
+    }
+
+    m_newFunctions.clear();
+}
+
+bool JitCache::registerFilter(const std::string& name, FilterFunction function) {
+    JitCache::filters().emplace(name, std::move(function));
+    return true;
+}
+
+bool JitCache::registerDefine(const std::string& name, DefineFunction function) {
+    JitCache::defines().emplace(name, std::move(function));
+    return true;
+}
+
+std::map<std::string, JitCache::FilterFunction>& JitCache::filters() {
+    static std::map<std::string, FilterFunction> functions;
+    return functions;
+}
+
+std::map<std::string, JitCache::DefineFunction>& JitCache::defines() {
+    static std::map<std::string, DefineFunction> functions;
+    return functions;
+}
+
+void JitCache::compileFunctions(const std::vector<std::pair<std::string, std::string> >& functions,
+                                const std::size_t depth,
+                                std::vector<std::string>* failedNames) const {
+
+    if (functions.size() == 1 || depth >= maxBisectionDepth) {
+        for (const auto& ifunction : functions) {
+            failedNames->emplace_back(ifunction.first);
+        }
+        return;
+    }
+
+    // bisect to find the failing functions, the others are still cached
+    const auto middle = functions.begin() + functions.size() / 2;
+    for (const auto& ipart : {std::vector<std::pair<std::string, std::string> >(functions.begin(), middle),
+                              std::vector<std::pair<std::string, std::string> >(middle, functions.end())}) {
+        if (this->writeAndCompile(ipart)) continue;
+        this->compileFunctions(ipart, depth + 1, failedNames);
+    }
+}
+
+bool JitCache::writeAndCompile(const std::vector<std::pair<std::string, std::string> >& functions) const {
+    std::string names;
+    for (const auto& ifunction : functions) {
+        names += ifunction.first;
+    }
+
+    std::ostringstream path;
+    path << m_directory << "/" << this->filePrefix() << std::hex << JitCache::hash(names) << ".C";
+
+    // other jobs may be loading the directory, only complete files get the name of a cache file
+    const std::string tmpPath = path.str() + ".tmp" + std::to_string(gSystem->GetPid());
+    if (!this->writeFile(tmpPath, functions)) {
+        LOG(WARNING) << "Cannot write the JIT cache file: " << tmpPath << "\n";
+        std::remove(tmpPath.c_str());
+        return false;
+    }
+    if (std::rename(tmpPath.c_str(), path.str().c_str()) != 0) {
+        LOG(WARNING) << "Cannot rename: " << tmpPath << " to: " << path.str() << "\n";
+        std::remove(tmpPath.c_str());
+        return false;
+    }
+
+    LOG(DEBUG) << "Compiling " << functions.size() << " expressions into: " << path.str() << "\n";
+    if (gSystem->CompileMacro(path.str().c_str(), "kO", "", m_directory.c_str()) != 1) {
+        LOG(DEBUG) << "Cannot compile the JIT cache file: " << path.str() << "\n";
+        gSystem->Unlink(path.str().c_str());
+        return false;
+    }
+
+    return true;
+}
+
+bool JitCache::compilesWithoutFunctions() const {
+    const std::string path = std::string(gSystem->TempDirectory()) + "/" + this->filePrefix() + "empty_" + std::to_string(gSystem->GetPid()) + ".C";
+    if (!this->writeFile(path, {})) return false;
+
+    const bool isCompiled = gSystem->CompileMacro(path.c_str(), "c", "", gSystem->TempDirectory()) == 1;
+    gSystem->Unlink(path.c_str());
+
+    return isCompiled;
+}
+
+bool JitCache::writeFile(const std::string& path,
+                         const std::vector<std::pair<std::string, std::string> >& functions) const {
+
+    std::ofstream out(path);
+    if (!out.good()) return false;
+
+    out << "// Generated by FastFrames, do not edit\n";
+    out << "#include \"FastFrames/DefineHelpers.h\"\n";
+    out << "#include \"FastFrames/JitCache.h\"\n\n";
+    out << "#include \"Math/Vector4D.h\"\n";
+    out << "#include \"ROOT/RDataFrame.hxx\"\n";
+    out << "#include \"ROOT/RVec.hxx\"\n\n";
+    out << "#include <cmath>\n";
+    out << "#include <string>\n";
+    out << "#include <vector>\n\n";
+    out << "using namespace ROOT::VecOps;\n\n";
+    for (const auto& ifunction : functions) {
+        out << "// cached: " << ifunction.first << "\n";
+        out << ifunction.second << "\n";
+    }
+    out.close();
+
+    return out.good();
+}
+
+bool JitCache::usedColumns(ROOT::RDF::RNode node,
+                           const std::string& expression,
+                           std::vector<std::pair<std::string, std::string> >* columns) {
+
+    auto isIdentifierChar = [](const char c) {
+        return std::isalnum(static_cast<unsigned char>(c)) || c == '_';
+    };
+
+    std::size_t position(0);
+    while (position < expression.size()) {
+        const char c = expression.at(position);
+
+        // skip string and character literals
+        if (c == '"' || c == '\'') {
+            ++position;
+            while (position < expression.size() && expression.at(position) != c) {
+                if (expression.at(position) == '\\') ++position;
+                ++position;
+            }
+            ++position;
+            continue;
+        }
+
+        // skip numbers, e.g. 1.5e3f
+        if (std::isdigit(static_cast<unsigned char>(c))) {
+            while (position < expression.size() && (isIdentifierChar(expression.at(position)) || expression.at(position) == '.')) {
+                ++position;
+            }
+            continue;
+        }
+
+        if (!isIdentifierChar(c)) {
+            ++position;
+            continue;
+        }
+
+        const std::size_t start = position;
+        while (position < expression.size() && isIdentifierChar(expression.at(position))) {
+            ++position;
+        }
+        const std::string identifier = expression.substr(start, position - start);
+
+        // members (a.b, a->b) and namespaces (a::b) are not columns
+        const bool isMember = (start > 0 && expression.at(start - 1) == '.') ||
+                              (start > 1 && expression.compare(start - 2, 2, "->") == 0) ||
+                              (start > 1 && expression.compare(start - 2, 2, "::") == 0);
+        if (isMember) continue;
+        if (expression.compare(position, 2, "::") == 0) continue;
+
+        // columns with a "." in the name (e.g. truth tree branches) are not supported
+        if (position < expression.size() && expression.at(position) == '.') {
+            std::size_t end = position + 1;
+            while (end < expression.size() && (isIdentifierChar(expression.at(end)) || expression.at(end) == '.')) {
+                ++end;
+            }
+            if (node.HasColumn(expression.substr(start, end - start))) return false;
+        }
+
+        if (!node.HasColumn(identifier)) continue;
+
+        auto itr = std::find_if(columns->begin(), columns->end(), [&identifier](const auto& element){return element.first == identifier;});
+        if (itr != columns->end()) continue;
+
+        const std::string type = node.GetColumnType(identifier);
+        if (type.empty()) return false;
+        columns->emplace_back(identifier, type);
+    }
+
+    return true;
+}
+
+std::string JitCache::functionName(const std::string& expression,
+                                   const std::vector<std::pair<std::string, std::string> >& columns,
+                                   const bool isFilter) const {
+
+    std::string key = this->filePrefix() + (isFilter ? "filter\n" : "define\n") + expression + "\n";
+    for (const auto& icolumn : columns) {
+        key += icolumn.first + ":" + icolumn.second + ";";
+    }
+
+    std::ostringstream result;
+    result << "fastFramesJit_" << std::hex << JitCache::hash(key);
+
+    return result.str();
+}
+
+std::uint64_t JitCache::hash(const std::string& text) {
+    std::uint64_t result = 14695981039346656037ULL;
+    for (const char c : text) {
+        result ^= static_cast<unsigned char>(c);
+        result *= 1099511628211ULL;
+    }
+
+    return result;
+}
+
+std::string JitCache::filePrefix() const {
+    return "FastFramesJitCache_" + std::to_string(ROOT_VERSION_CODE) + "_";
+}
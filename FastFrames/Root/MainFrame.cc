@@ -6,17 +6,25 @@
 
 #include "FastFrames/MainFrame.h"
 
+#include "FastFrames/CompiledExpressions.h"
+#include "FastFrames/CutflowHelper.h"
+#include "FastFrames/JitCache.h"
 #include "FastFrames/Logger.h"
 #include "FastFrames/ObjectCopier.h"
 #include "FastFrames/Sample.h"
+#include "FastFrames/SortedTreeIndex.h"
 #include "FastFrames/UniqueSampleID.h"
 #include "FastFrames/Utils.h"
 #include "FastFrames/VariableMacros.h"
+#include "FastFrames/WeightExpression.h"
 #include "FastFrames/SimpleONNXInference.h"
+#include "FastFrames/SystematicHistoHelper.h"
 
 #include "TChain.h"
+#include "TNamed.h"
+#include "TROOT.h"
 #include "TSystem.h"
-#include "TTreeIndex.h"
+#include "TVirtualIndex.h"
 #include "Math/Vector4D.h"
 #include "ROOT/RDFHelpers.hxx"
 #include "ROOT/RDF/RSampleInfo.hxx"
@@ -24,6 +32,7 @@
 #include <algorithm>
 #include <iostream>
 #include <exception>
+#include <future>
 #include <regex>
 #include <utility>
 
@@ -67,6 +76,10 @@ void MainFrame::init() {
 
     this->prepareONNXwrapper();
 
+    if (!m_config->jitCacheDirectory().empty()) {
+        m_jitCache = std::make_unique<JitCache>(m_config->jitCacheDirectory());
+        m_jitCache->load();
+    }
 }
 
 void MainFrame::executeHistograms() {
@@ -80,6 +93,17 @@ void MainFrame::executeHistograms() {
     LOG(INFO) << "-------------------------------------\n";
     LOG(INFO) << "Started the main histogram processing\n";
     LOG(INFO) << "-------------------------------------\n";
+
+    // samples that are booked but whose event loop has not been triggered yet
+    if (m_config->maxConcurrentGraphs() > 1 && !m_config->simpleONNXInferences().empty()) {
+        LOG(WARNING) << "The simple ONNX inference buffers are shared between the graphs that run concurrently, setting max_concurrent_graphs to 1\n";
+    }
+    const std::size_t maxConcurrentGraphs = this->maxConcurrentGraphs();
+    std::vector<std::tuple<std::shared_ptr<Sample>,
+                           std::vector<SystematicHisto>,
+                           std::vector<CutflowContainer>,
+                           ROOT::RDF::RNode> > bookedSamples;
+
     std::size_t sampleN(1);
     for (const auto& isample : m_config->samples()) {
         LOG(INFO) << "\n";
@@ -92,6 +116,17 @@ void MainFrame::executeHistograms() {
             auto&& finalCutflowContainers = std::get<2>(finalProduct);
 
             this->writeHistosToFile(finalSystHistos, finalTruthHistos, finalCutflowContainers, isample, false);
+        } else if (maxConcurrentGraphs > 1) {
+            LOG(DEBUG) << "Booking all unique samples in one go, the event loop will be run together with other samples\n";
+            auto finalProduct = this->processSampleWithAllUniqueSamples(isample);
+            bookedSamples.emplace_back(isample,
+                                       std::move(std::get<0>(finalProduct)),
+                                       std::move(std::get<1>(finalProduct)),
+                                       std::get<2>(finalProduct));
+
+            if (bookedSamples.size() >= maxConcurrentGraphs) {
+                this->runBookedSamplesAndWrite(bookedSamples);
+            }
         } else {
             LOG(DEBUG) << "Processing all unique samples in one go\n";
             auto finalProduct = this->processSampleWithAllUniqueSamples(isample);
@@ -104,93 +139,207 @@ void MainFrame::executeHistograms() {
 
         ++sampleN;
     }
+
+    // process the remaining booked samples
+    this->runBookedSamplesAndWrite(bookedSamples);
+
+    this->writeCompiledExpressions();
+
+    // the registered ONNX models are only used by the event loops of this run
+    SimpleONNXInference::clearRegisteredInstances();
+}
+
+std::size_t MainFrame::maxConcurrentGraphs() const {
+    if (m_config->maxConcurrentGraphs() <= 1) return 1;
+
+    // the inference buffers are indexed by the processing slot which is not unique across concurrent graphs
+    if (!m_config->simpleONNXInferences().empty()) return 1;
+
+    return m_config->maxConcurrentGraphs();
+}
+
+void MainFrame::runBookedSamplesAndWrite(std::vector<std::tuple<std::shared_ptr<Sample>,
+                                                                std::vector<SystematicHisto>,
+                                                                std::vector<CutflowContainer>,
+                                                                ROOT::RDF::RNode> >& bookedSamples) {
+
+    if (bookedSamples.empty()) return;
+
+    // RunGraphs only needs one result per computation graph to trigger it,
+    // all other booked results of the same graph are filled in the same event loop
+    std::vector<ROOT::RDF::RResultHandle> handles;
+    std::vector<ROOT::RDF::RResultPtr<ULong64_t> > counts;
+    for (auto& ibooked : bookedSamples) {
+        counts.emplace_back(std::get<3>(ibooked).Count());
+        handles.emplace_back(counts.back());
+    }
+
+    LOG(INFO) << "\n";
+    LOG(INFO) << "Triggering the event loops for " << bookedSamples.size() << " samples concurrently\n";
+    ROOT::RDF::RunGraphs(handles);
+
+    for (std::size_t i = 0; i < bookedSamples.size(); ++i) {
+        auto& ibooked = bookedSamples.at(i);
+        const std::shared_ptr<Sample>& sample = std::get<0>(ibooked);
+        LOG(INFO) << "Sample: " << sample->name() << " processed " << counts.at(i).GetValue() << " events\n";
+        LOG(DEBUG) << "Number of event loops: " << std::get<3>(ibooked).GetNRuns() << ". For an optimal run, this number should be 1\n";
+
+        // the results are already available, no event loop is triggered here
+        this->writeHistosToFile(std::get<1>(ibooked), {}, std::get<2>(ibooked), sample, true);
+    }
+
+    LOG(DEBUG) << "Deleting RDF objects of the processed samples\n";
+    bookedSamples.clear();
 }
 
 std::tuple<std::vector<SystematicHisto>,
            std::vector<VariableHisto>,
            std::vector<CutflowContainer> > MainFrame::processHistogramsSplitPerUniqueSample(const std::shared_ptr<Sample>& sample) {
 
-    std::vector<SystematicHisto> finalSystHistos;
-    std::vector<VariableHisto> finalTruthHistos;
-    std::vector<CutflowContainer> finalCutflowContainers;
+    // histograms that have been copied from the RDF results, these can be merged in parallel
+    std::vector<std::tuple<std::vector<SystematicHisto>,
+                           std::vector<VariableHisto>,
+                           std::vector<CutflowContainer> > > products;
+
+    // unique samples that are booked, but the event loop has not been triggered yet
+    std::vector<std::tuple<std::vector<SystematicHisto>,
+                           std::vector<VariableHisto>,
+                           std::vector<CutflowContainer>,
+                           ROOT::RDF::RNode,
+                           std::unique_ptr<TChain>,
+                           std::vector<std::pair<std::unique_ptr<TChain>, std::unique_ptr<TVirtualIndex> > > > > booked;
+
+    const std::size_t maxConcurrentGraphs = this->maxConcurrentGraphs();
+    const std::size_t nUniqueSamples = sample->uniqueSampleIDs().size();
 
     std::size_t uniqueSampleN(1);
     for (const auto& iUniqueSampleID : sample->uniqueSampleIDs()) {
         LOG(INFO) << "\n";
-        LOG(INFO) << "Processing unique sample: " << iUniqueSampleID << ", " << uniqueSampleN << " out of " << sample->uniqueSampleIDs().size() << " unique samples\n";
+        LOG(INFO) << "Processing unique sample: " << iUniqueSampleID << ", " << uniqueSampleN << " out of " << nUniqueSamples << " unique samples\n";
 
         auto currentHistos = this->processUniqueSample(sample, iUniqueSampleID);
-        auto&& systematicHistos = std::get<0>(currentHistos);
-        auto&& truthHistos      = std::get<1>(currentHistos);
-        auto&& cutflows         = std::get<2>(currentHistos);
-        auto node               = std::get<3>(currentHistos);
-        auto recoChain          = std::move(std::get<4>(currentHistos));
-        auto truthChains        = std::move(std::get<5>(currentHistos));
         // this happens when there are no files provided
-        if (systematicHistos.empty()) {
+        if (!std::get<0>(currentHistos).empty()) {
+            booked.emplace_back(std::move(currentHistos));
+        }
+
+        if (booked.size() < maxConcurrentGraphs && uniqueSampleN < nUniqueSamples) {
             ++uniqueSampleN;
             continue;
         }
+        ++uniqueSampleN;
+        if (booked.empty()) continue;
+
+        // RunGraphs only needs one result per computation graph to trigger it
+        std::vector<ROOT::RDF::RResultHandle> handles;
+        for (const auto& ibooked : booked) {
+            for (const auto& itruth : std::get<1>(ibooked)) {
+                handles.emplace_back(itruth.histo());
+            }
+            handles.emplace_back(std::get<3>(ibooked).Count());
+        }
 
-        // merge the histograms or take them if it is the first set
-        if (finalSystHistos.empty())  {
-            LOG(INFO) << "Triggering event loop for the reco tree\n";
+        LOG(INFO) << "Triggering the event loops for " << booked.size() << " unique sample(s) concurrently\n";
+        ROOT::RDF::RunGraphs(handles);
+
+        for (auto& ibooked : booked) {
+            auto&& systematicHistos = std::get<0>(ibooked);
+            auto&& truthHistos      = std::get<1>(ibooked);
+            auto&& cutflows         = std::get<2>(ibooked);
+            auto&& node             = std::get<3>(ibooked);
+
+            std::vector<SystematicHisto> copiedSystHistos;
             for (const auto& isystHist : systematicHistos) {
-                finalSystHistos.emplace_back(isystHist.copy());
+                copiedSystHistos.emplace_back(isystHist.copy());
             }
-        } else {
-            if (systematicHistos.size() != finalSystHistos.size()) {
-                LOG(ERROR) << "Number of the systematic histograms do not match\n";
-                LOG(ERROR) << "Size of the current histograms: " << systematicHistos.size() << ", final histograms: " << finalSystHistos.size() << "\n";
-                throw std::runtime_error("");
+
+            std::vector<VariableHisto> copiedTruthHistos;
+            for (const auto& ivariable : truthHistos) {
+                copiedTruthHistos.emplace_back(ivariable.name());
+                copiedTruthHistos.back().copyHisto(ivariable.histo());
             }
 
-            LOG(INFO) << "Merging samples, triggering the event loop for the reco tree!\n";
-            for (std::size_t isyst = 0; isyst < finalSystHistos.size(); ++isyst) {
-                finalSystHistos.at(isyst).merge(systematicHistos.at(isyst));
+            std::vector<CutflowContainer> copiedCutflows;
+            for (auto& cutflow : cutflows) {
+                copiedCutflows.emplace_back(cutflow.name());
+                copiedCutflows.back().copyValues(cutflow);
             }
+
+            LOG(DEBUG) << "Number of event loops: " << node.GetNRuns() << ". For an optimal run, this number should be 1\n";
+            products.emplace_back(std::move(copiedSystHistos), std::move(copiedTruthHistos), std::move(copiedCutflows));
         }
-        if (!cutflows.empty()) {
-            LOG(DEBUG) << "Processing cutflows\n";
-            if (finalCutflowContainers.empty()) {
-                for (auto& cutflow : cutflows) {
-                    finalCutflowContainers.emplace_back(cutflow.name());
-                    finalCutflowContainers.back().copyValues(cutflow);
-                }
-            } else {
-                for (std::size_t i = 0; i < cutflows.size(); ++i) {
-                    finalCutflowContainers.at(i).mergeValues(cutflows.at(i));
-                }
-            }
-            LOG(DEBUG) << "Finished processing cutflows\n";
-        }
-        LOG(DEBUG) << "Number of event loops: " << node.GetNRuns() << ". For an optimal run, this number should be 1\n";
-        if (!truthHistos.empty()) {
-            if (finalTruthHistos.empty()) {
-                LOG(INFO) << "Triggering the event loop for the truth tree\n";
-                for (const auto& ivariable : truthHistos) {
-                    finalTruthHistos.emplace_back(ivariable.name());
-                    finalTruthHistos.back().copyHisto(ivariable.histo());
-                }
-            } else {
-                LOG(INFO) << "Merging truth, triggering the event loop for the truth trees!\n";
-                if (finalTruthHistos.size() != truthHistos.size()) {
-                    LOG(ERROR) << "Sizes of truth histograms do not match!\n";
-                    throw std::runtime_error("");
-                }
-                for (std::size_t ihist = 0; ihist < truthHistos.size(); ++ihist) {
-                    finalTruthHistos.at(ihist).mergeHisto(truthHistos.at(ihist).histo());
-                }
-            }
+
+        LOG(DEBUG) << "Deleting RDF objects, truth chains and the TTree indices\n";
+        booked.clear();
+
+        LOG(INFO) << "Merging " << products.size() << " set(s) of histograms\n";
+        this->reduceHistoProducts(products);
+    }
+
+    if (products.empty()) {
+        return std::make_tuple(std::vector<SystematicHisto>{}, std::vector<VariableHisto>{}, std::vector<CutflowContainer>{});
+    }
+
+    return std::move(products.front());
+}
+
+void MainFrame::reduceHistoProducts(std::vector<std::tuple<std::vector<SystematicHisto>,
+                                                           std::vector<VariableHisto>,
+                                                           std::vector<CutflowContainer> > >& products) const {
+
+    // pairwise merging, each level of the tree is merged in parallel
+    while (products.size() > 1) {
+        const std::size_t half = (products.size() + 1) / 2;
+        std::vector<std::future<void> > futures;
+        for (std::size_t i = 0; i + half < products.size(); ++i) {
+            futures.emplace_back(std::async(std::launch::async, [this, &products, i, half]() {
+                this->mergeHistoProducts(products.at(i), products.at(i + half));
+            }));
         }
-        ++uniqueSampleN;
-        if (!truthChains.empty()) {
-            LOG(DEBUG) << "Deleting truth chains and the TTree indices\n";
+        for (auto& ifuture : futures) {
+            ifuture.get();
         }
-        LOG(DEBUG) << "Deleting RDF objects (out of scope)\n";
+        products.erase(products.begin() + half, products.end());
     }
+}
 
-    return std::make_tuple(std::move(finalSystHistos), std::move(finalTruthHistos), std::move(finalCutflowContainers));
+void MainFrame::mergeHistoProducts(std::tuple<std::vector<SystematicHisto>,
+                                              std::vector<VariableHisto>,
+                                              std::vector<CutflowContainer> >& target,
+                                   const std::tuple<std::vector<SystematicHisto>,
+                                                    std::vector<VariableHisto>,
+                                                    std::vector<CutflowContainer> >& other) const {
+
+    auto& targetSystHistos = std::get<0>(target);
+    const auto& otherSystHistos = std::get<0>(other);
+    if (targetSystHistos.size() != otherSystHistos.size()) {
+        LOG(ERROR) << "Number of the systematic histograms do not match\n";
+        LOG(ERROR) << "Size of the current histograms: " << otherSystHistos.size() << ", final histograms: " << targetSystHistos.size() << "\n";
+        throw std::runtime_error("");
+    }
+    for (std::size_t isyst = 0; isyst < targetSystHistos.size(); ++isyst) {
+        targetSystHistos.at(isyst).mergeCopy(otherSystHistos.at(isyst));
+    }
+
+    auto& targetTruthHistos = std::get<1>(target);
+    const auto& otherTruthHistos = std::get<1>(other);
+    if (targetTruthHistos.size() != otherTruthHistos.size()) {
+        LOG(ERROR) << "Sizes of truth histograms do not match!\n";
+        throw std::runtime_error("");
+    }
+    for (std::size_t ihist = 0; ihist < targetTruthHistos.size(); ++ihist) {
+        targetTruthHistos.at(ihist).mergeHisto(otherTruthHistos.at(ihist).histoUniquePtr());
+    }
+
+    auto& targetCutflows = std::get<2>(target);
+    const auto& otherCutflows = std::get<2>(other);
+    if (targetCutflows.size() != otherCutflows.size()) {
+        LOG(ERROR) << "Sizes of cutflows do not match!\n";
+        throw std::runtime_error("");
+    }
+    for (std::size_t i = 0; i < targetCutflows.size(); ++i) {
+        targetCutflows.at(i).mergeCopiedValues(otherCutflows.at(i));
+    }
 }
 
 
@@ -226,6 +375,11 @@ void MainFrame::executeNtuples() {
         }
         ++sampleN;
     }
+
+    this->writeCompiledExpressions();
+
+    // the registered ONNX models are only used by the event loops of this run
+    SimpleONNXInference::clearRegisteredInstances();
 }
 
 std::tuple<std::vector<SystematicHisto>,
@@ -233,12 +387,15 @@ std::tuple<std::vector<SystematicHisto>,
            std::vector<CutflowContainer>,
            ROOT::RDF::RNode,
            std::unique_ptr<TChain>,
-           std::vector<std::pair<std::unique_ptr<TChain> , std::unique_ptr<TTreeIndex> > > > MainFrame::processUniqueSample(const std::shared_ptr<Sample>& sample,
+           std::vector<std::pair<std::unique_ptr<TChain> , std::unique_ptr<TVirtualIndex> > > > MainFrame::processUniqueSample(const std::shared_ptr<Sample>& sample,
                                                                                                                             const UniqueSampleID& uniqueSampleID) {
 
     const std::vector<std::string>& filePaths = m_metadataManager.filePaths(uniqueSampleID);
     std::vector<std::string> selectedFilePaths(filePaths);
-    std::vector<std::pair<std::unique_ptr<TChain>, std::unique_ptr<TTreeIndex> > > truthChains;
+    // files processed from their first entry, objects processed per file (e.g. truth trees) are only read from these
+    std::vector<std::string> ownedFilePaths(filePaths);
+    std::vector<Utils::FileEntryRange> entryRanges;
+    std::vector<std::pair<std::unique_ptr<TChain>, std::unique_ptr<TVirtualIndex> > > truthChains;
     if (m_config->totalJobSplits() > 0) {
         if (sample->hasUnfolding()) {
             LOG(WARNING) << "#############################################################################################\n";
@@ -246,7 +403,19 @@ std::tuple<std::vector<SystematicHisto>,
             LOG(WARNING) << "You will not be able to \"hadd\" the output to get the efficiency and acceptance histograms\n";
             LOG(WARNING) << "#############################################################################################\n";
         }
-        selectedFilePaths = Utils::selectedFileList(filePaths, m_config->totalJobSplits(), m_config->currentJobIndex());
+        if (m_config->splitJobsByEntries()) {
+            entryRanges = Utils::selectedEntryRanges(filePaths, sample->recoTreeName(), m_config->totalJobSplits(), m_config->currentJobIndex());
+            selectedFilePaths = Utils::filesFromEntryRanges(entryRanges, false);
+            ownedFilePaths = Utils::filesFromEntryRanges(entryRanges, true);
+            auto& processedRanges = m_jobEntryRanges[sample->name()];
+            processedRanges.insert(processedRanges.end(), entryRanges.begin(), entryRanges.end());
+            const std::vector<Utils::FileEntryRange> inputRanges = Utils::fullEntryRanges(filePaths, sample->recoTreeName());
+            auto& allRanges = m_jobInputRanges[sample->name()];
+            allRanges.insert(allRanges.end(), inputRanges.begin(), inputRanges.end());
+        } else {
+            selectedFilePaths = Utils::selectedFileList(filePaths, m_config->totalJobSplits(), m_config->currentJobIndex());
+            ownedFilePaths = selectedFilePaths;
+        }
     }
     if (selectedFilePaths.empty()) {
         LOG(WARNING) << "UniqueSample: " << uniqueSampleID << " has no files, will not produce histograms\n";
@@ -261,18 +430,25 @@ std::tuple<std::vector<SystematicHisto>,
 
     if (sample->hasTruth()) {
         LOG(DEBUG) << "Processing standalone truth histograms\n";
-        truthHistos = this->processTruthHistos(selectedFilePaths, sample, uniqueSampleID);
+        // the truth trees of the files split between several jobs are processed by the job starting at their first entry
+        if (ownedFilePaths.empty()) {
+            truthHistos = this->processTruthHistos({selectedFilePaths.front()}, sample, uniqueSampleID, true);
+        } else {
+            truthHistos = this->processTruthHistos(ownedFilePaths, sample, uniqueSampleID);
+        }
         LOG(DEBUG) << "Done processing standalone truth histograms\n";
     }
 
     std::unique_ptr<TChain> recoChain = Utils::chainFromFiles(sample->recoTreeName(), selectedFilePaths);
-    const bool hasZeroEvents = recoChain->GetEntries() == 0;
+    Utils::applyEntryRanges(recoChain, sample->recoTreeName(), entryRanges);
+    // RNTuple inputs are not read through a chain, empty inputs simply give empty histograms
+    const bool hasZeroEvents = recoChain && recoChain->GetEntries() == 0;
 
     if (sample->hasTruth()) {
         truthChains = this->connectTruthTrees(recoChain, sample, selectedFilePaths);
     }
 
-    ROOT::RDataFrame df(*recoChain);
+    ROOT::RDataFrame df = Utils::dataFrameFromFiles(sample->recoTreeName(), selectedFilePaths, recoChain);
     ROOT::RDF::RNode mainNode = df;
 
     if (hasZeroEvents) {
@@ -328,8 +504,14 @@ std::tuple<std::vector<SystematicHisto>,
     std::vector<std::vector<ROOT::RDF::RNode> > filterStore = this->applyFilters(mainNode, sample, uniqueSampleID);
     LOG(DEBUG) << "Finished booking filters\n";
 
+    // book the 1D histograms for all systematics at once
+    PackedHistoContainer packedHistos;
+    if (m_config->vectoriseSystematicHistograms()) {
+        packedHistos = this->bookPackedHistos1D(mainNode, filterStore, sample, uniqueSampleID);
+    }
+
     // retrieve the histograms;
-    std::vector<SystematicHisto> histoContainer = this->processHistograms(filterStore, sample);
+    std::vector<SystematicHisto> histoContainer = this->processHistograms(filterStore, sample, packedHistos);
     LOG(DEBUG) << "Finished booking histograms\n";
 
     return std::make_tuple(std::move(histoContainer), std::move(truthHistos), std::move(cutflows), std::move(mainNode), std::move(recoChain), std::move(truthChains));
@@ -342,6 +524,26 @@ std::tuple<std::vector<SystematicHisto>,
     // we could use any file from the list, use the first one
     m_systReplacer.readSystematicMapFromFile(sample->oneFilePath(m_metadataManager), sample->recoTreeName(), sample->systematics());
 
+    if (m_config->totalJobSplits() > 0 && m_config->splitJobsByEntries()) {
+        const std::vector<Utils::FileEntryRange>& entryRanges = m_jobEntryRanges[sample->name()] = m_metadataManager.entryRanges(sample, m_config);
+        std::vector<Utils::FileEntryRange>& allRanges = m_jobInputRanges[sample->name()];
+        allRanges.clear();
+        for (const auto& id : sample->uniqueSampleIDs()) {
+            const std::vector<Utils::FileEntryRange> inputRanges = Utils::fullEntryRanges(m_metadataManager.filePaths(id), sample->recoTreeName());
+            allRanges.insert(allRanges.end(), inputRanges.begin(), inputRanges.end());
+        }
+
+        long long nEntries(0);
+        for (const auto& irange : entryRanges) {
+            nEntries += irange.lastEntry - irange.firstEntry;
+        }
+        if (nEntries == 0) {
+            LOG(WARNING) << "Sample: " << sample->name() << " has no entries in this job, will not produce histograms\n";
+            ROOT::RDataFrame tmp(1);
+            return std::make_tuple(std::vector<SystematicHisto>{}, std::vector<CutflowContainer>{}, tmp);
+        }
+    }
+
     auto spec = m_metadataManager.dataSpec(sample, m_config);
 
     ROOT::RDataFrame df(spec);
@@ -389,8 +591,14 @@ std::tuple<std::vector<SystematicHisto>,
     std::vector<std::vector<ROOT::RDF::RNode> > filterStore = this->applyFilters(mainNode, sample, dummy);
     LOG(DEBUG) << "Finished booking filters\n";
 
+    // book the 1D histograms for all systematics at once
+    PackedHistoContainer packedHistos;
+    if (m_config->vectoriseSystematicHistograms()) {
+        packedHistos = this->bookPackedHistos1D(mainNode, filterStore, sample, dummy);
+    }
+
     // retrieve the histograms;
-    std::vector<SystematicHisto> histoContainer = this->processHistograms(filterStore, sample);
+    std::vector<SystematicHisto> histoContainer = this->processHistograms(filterStore, sample, packedHistos);
     LOG(DEBUG) << "Finished booking histograms\n";
 
     return std::make_tuple(std::move(histoContainer), std::move(cutflows), std::move(mainNode));
@@ -401,8 +609,18 @@ void MainFrame::processUniqueSampleNtuple(const std::shared_ptr<Sample>& sample,
 
     const std::vector<std::string>& filePaths = m_metadataManager.filePaths(id);
     std::vector<std::string> selectedFilePaths(filePaths);
+    // files processed from their first entry, the truth trees and metadata are only copied from these
+    std::vector<std::string> ownedFilePaths(filePaths);
+    std::vector<Utils::FileEntryRange> entryRanges;
     if (m_config->totalJobSplits() > 0) {
-        selectedFilePaths = Utils::selectedFileList(filePaths, m_config->totalJobSplits(), m_config->currentJobIndex());
+        if (m_config->splitJobsByEntries()) {
+            entryRanges = Utils::selectedEntryRanges(filePaths, sample->recoTreeName(), m_config->totalJobSplits(), m_config->currentJobIndex());
+            selectedFilePaths = Utils::filesFromEntryRanges(entryRanges, false);
+            ownedFilePaths = Utils::filesFromEntryRanges(entryRanges, true);
+        } else {
+            selectedFilePaths = Utils::selectedFileList(filePaths, m_config->totalJobSplits(), m_config->currentJobIndex());
+            ownedFilePaths = selectedFilePaths;
+        }
     }
     if (selectedFilePaths.empty()) {
         LOG(WARNING) << "UniqueSample: " << id << " has no files, will not produce output ntuple\n";
@@ -419,16 +637,17 @@ void MainFrame::processUniqueSampleNtuple(const std::shared_ptr<Sample>& sample,
     }
 
     auto chain = Utils::chainFromFiles(sample->recoTreeName(), selectedFilePaths);
+    Utils::applyEntryRanges(chain, sample->recoTreeName(), entryRanges);
 
-    std::vector<std::pair<std::unique_ptr<TChain>, std::unique_ptr<TTreeIndex> > > truthChains;
+    std::vector<std::pair<std::unique_ptr<TChain>, std::unique_ptr<TVirtualIndex> > > truthChains;
     if (sample->hasTruth()) {
         truthChains = this->connectTruthTrees(chain, sample, selectedFilePaths);
     }
 
-    const bool hasZeroEvents = chain->GetEntries() == 0;
+    const bool hasZeroEvents = chain && chain->GetEntries() == 0;
     if (hasZeroEvents) LOG(WARNING) << "UniqueSampleID: " << id << ", has no events, skipping it\n";
 
-    ROOT::RDataFrame df(*chain);
+    ROOT::RDataFrame df = Utils::dataFrameFromFiles(sample->recoTreeName(), selectedFilePaths, chain);
 
     ROOT::RDF::RNode mainNode = df;
     #if ROOT_VERSION_CODE > ROOT_VERSION(6,29,0)
@@ -460,11 +679,6 @@ void MainFrame::processUniqueSampleNtuple(const std::shared_ptr<Sample>& sample,
         mainNode = this->addWeightColumns(mainNode, sample, id);
 
         m_systReplacer.printMaps();
-
-        // apply filter
-        if (!m_config->ntuple()->selection().empty()) {
-            mainNode = mainNode.Filter(this->systematicOrFilter(sample));
-        }
     }
 
     //store the file
@@ -473,50 +687,89 @@ void MainFrame::processUniqueSampleNtuple(const std::shared_ptr<Sample>& sample,
     if (m_config->totalJobSplits() > 0) {
         suffix = "_Njobs_" + std::to_string(m_config->totalJobSplits()) + "_jobIndex_" + std::to_string(m_config->currentJobIndex());
     }
-    const std::string fileName = folder + sample->name() + "_" + std::to_string(id.dsid())+"_" + id.campaign() + "_"+id.simulation() + suffix + ".root";
+    const std::string baseName = folder + sample->name() + "_" + std::to_string(id.dsid())+"_" + id.campaign() + "_"+id.simulation();
     const bool nominalOnly = sample->nominalOnly();
     const std::vector<std::string> allBranches = mainNode.GetColumnNames();
-    const std::vector<std::string> selectedBranches = m_config->ntuple()->listOfSelectedBranches(nominalOnly ? m_systReplacer.nominalBranches(allBranches) : allBranches);
-    LOG(VERBOSE) << "List of selected branches:\n";
-    for (const auto& iselected : selectedBranches) {
-        LOG(VERBOSE) << "\t" << iselected << "\n";
+    const std::vector<std::string> branches = nominalOnly ? m_systReplacer.nominalBranches(allBranches) : allBranches;
+
+    // file name, selection and selected branches for each output
+    // without named outputs, only one file is written using the options of the ntuple block
+    std::vector<std::tuple<std::string, std::string, std::vector<std::string> > > outputs;
+    if (m_config->ntuple()->outputs().empty()) {
+        outputs.emplace_back(baseName + suffix + ".root", m_config->ntuple()->selection(), m_config->ntuple()->listOfSelectedBranches(branches));
+    } else {
+        for (const auto& ioutput : m_config->ntuple()->outputs()) {
+            outputs.emplace_back(baseName + ioutput->fileSuffix() + suffix + ".root", ioutput->selection(), ioutput->listOfSelectedBranches(branches));
+        }
     }
-    LOG(INFO) << "Writing the ntuple to: " << fileName << "\n";
-    LOG(INFO) << "Triggering the event loop for the reco tree!\n";
+
+    // all the outputs are booked lazily and written in the same event loop
     ROOT::RDF::RSnapshotOptions opts;
     opts.fAutoFlush = m_config->ntupleAutoFlush();
     opts.fCompressionLevel = m_config->ntupleCompressionLevel();
     opts.fVector2RVec = m_config->convertVectorToRVec();
-    mainNode.Snapshot(sample->recoTreeName(), fileName, selectedBranches, opts);
-    LOG(DEBUG) << "Number of event loops: " << mainNode.GetNRuns() << ". For an optimal run, this number should be 1\n";
-
-    auto nEntriesAfterCuts = mainNode.Count().GetValue();
-    if (nEntriesAfterCuts==0) {
-        LOG(WARNING) << "UniqueSampleID: " << id << ", has no events after cuts, generating an empty reco TTree\n";
+    opts.fLazy = true;
+    Utils::setSnapshotFormat(opts, m_config->ntupleFormat());
+    std::vector<ROOT::RDF::RResultPtr<ROOT::RDF::RInterface<ROOT::Detail::RDF::RLoopManager> > > snapshots;
+    std::vector<ROOT::RDF::RResultPtr<ULong64_t> > counts;
+    for (const auto& [fileName, selection, selectedBranches] : outputs) {
+        ROOT::RDF::RNode outputNode = mainNode;
+        if (!hasZeroEvents && !selection.empty()) {
+            outputNode = this->filterWithCache(mainNode, this->systematicOrFilter(sample, selection));
+        }
+        LOG(VERBOSE) << "List of selected branches for: " << fileName << "\n";
+        for (const auto& iselected : selectedBranches) {
+            LOG(VERBOSE) << "\t" << iselected << "\n";
+        }
+        LOG(INFO) << "Writing the ntuple to: " << fileName << "\n";
+        snapshots.emplace_back(outputNode.Snapshot(sample->recoTreeName(), fileName, selectedBranches, opts));
+        counts.emplace_back(outputNode.Count());
     }
-    // IF run in multi-threaded mode, we need to manually add an empty tree:
-    // See ROOT::DataFrame::Snapshot for more details
-    if (m_config->numCPU()!=1 && nEntriesAfterCuts==0){
-        const char* emptyTreeName = sample->recoTreeName().c_str();
-        TTree emptyTree(emptyTreeName, emptyTreeName);
-        // Write to the file.
-        TFile file(fileName.c_str(), "UPDATE");
-        emptyTree.Write();
-        file.Close();
+
+    LOG(INFO) << "Triggering the event loop for the reco tree!\n";
+    for (auto& isnapshot : snapshots) {
+        isnapshot.GetValue();
     }
+    LOG(DEBUG) << "Number of event loops: " << mainNode.GetNRuns() << ". For an optimal run, this number should be 1\n";
 
-    for (const auto& itruth : sample->truths()) {
-        this->processSingleTruthTreeNtuple(itruth, selectedFilePaths, fileName, sample, id);
+    std::vector<std::string> fileNames;
+    for (std::size_t ioutput = 0; ioutput < outputs.size(); ++ioutput) {
+        const std::string& fileName = std::get<0>(outputs.at(ioutput));
+        fileNames.emplace_back(fileName);
+        auto nEntriesAfterCuts = counts.at(ioutput).GetValue();
+        if (nEntriesAfterCuts==0) {
+            LOG(WARNING) << "UniqueSampleID: " << id << ", has no events after cuts for: " << fileName << ", generating an empty reco TTree\n";
+        }
+        // IF run in multi-threaded mode, we need to manually add an empty tree:
+        // See ROOT::DataFrame::Snapshot for more details
+        // Not needed for RNTuple, the RNTuple is always written
+        if (m_config->numCPU()!=1 && nEntriesAfterCuts==0 && m_config->ntupleFormat() == "ttree"){
+            const char* emptyTreeName = sample->recoTreeName().c_str();
+            TTree emptyTree(emptyTreeName, emptyTreeName);
+            // Write to the file.
+            TFile file(fileName.c_str(), "UPDATE");
+            emptyTree.Write();
+            file.Close();
+        }
     }
 
-    ObjectCopier copier(selectedFilePaths);
-    copier.readObjectInfo();
-    if (!m_config->ntuple()->copyTrees().empty()) {
-        copier.copyTreesTo(fileName, m_config->ntuple()->copyTrees(), m_config->convertVectorToRVec());
+    if (ownedFilePaths.empty()) {
+        LOG(INFO) << "All files of UniqueSampleID: " << id << " are processed from their first entry by other jobs, not copying truth trees and metadata\n";
+    } else {
+        // every input tree is read only once, also when writing several outputs
+        for (const auto& itruth : sample->truths()) {
+            this->processSingleTruthTreeNtuple(itruth, ownedFilePaths, fileNames, sample, id);
+        }
+
+        ObjectCopier copier(ownedFilePaths);
+        copier.readObjectInfo();
+        if (!m_config->ntuple()->copyTrees().empty()) {
+            copier.copyTreesTo(fileNames, m_config->ntuple()->copyTrees(), m_config->convertVectorToRVec(), m_config->ntupleFormat());
+        }
+        LOG(INFO) << "Copying metadata from the original files to: " << StringOperations::joinStrings(", ", fileNames) << "\n";
+        copier.copyObjectsTo(fileNames);
+        LOG(INFO) << "Finished copying metadata from the original files\n";
     }
-    LOG(INFO) << "Copying metadata from the original files\n";
-    copier.copyObjectsTo(fileName);
-    LOG(INFO) << "Finished copying metadata from the original files\n";
 
     if (!truthChains.size()) {
         LOG(DEBUG) << "Deleting truth chains\n";
@@ -538,8 +791,7 @@ std::string MainFrame::systematicFilter(const std::shared_ptr<Sample>& sample,
     return systSelection;
 }
 
-std::string MainFrame::systematicOrFilter(const std::shared_ptr<Sample>& sample) const {
-    const std::string& nominalSelection = m_config->ntuple()->selection();
+std::string MainFrame::systematicOrFilter(const std::shared_ptr<Sample>& sample, const std::string& nominalSelection) const {
 
     std::string result = "(" + nominalSelection + ")";
     if (!sample->nominalOnly()) {
@@ -586,19 +838,116 @@ std::vector<std::vector<ROOT::RDF::RNode> > MainFrame::applyFilters(ROOT::RDF::R
                                                                     const std::shared_ptr<Sample>& sample,
                                                                     const UniqueSampleID& id) {
 
+    if (m_config->regionBitmask()) {
+        return this->applyBitmaskFilters(mainNode, sample, id);
+    }
+
     std::vector<std::vector<ROOT::RDF::RNode> > result;
 
+    // systematics that do not change the selection (e.g. weight-only) share the filter node, per region
+    std::vector<std::map<std::string, ROOT::RDF::RNode> > uniqueFilters(sample->regions().size());
+
+    // the terms of the selections are shared between the regions and systematics starting with the same terms
+    std::map<std::vector<std::string>, ROOT::RDF::RNode> filterTree;
+    filterTree.emplace(std::vector<std::string>{}, mainNode);
+
     for (const auto& isyst : sample->systematics()) {
         std::vector<ROOT::RDF::RNode> perSystFilter;
+        std::size_t regIndex(0);
         for (const auto& ireg : sample->regions()) {
 
             if (sample->skipSystematicRegionCombination(isyst, ireg)) {
                 LOG(DEBUG) << "Skipping region: " << ireg->name() << ", systematic: " << isyst->name() << " combination for sample: " << sample->name() << " (filter)\n";
+                ++regIndex;
                 continue;
             }
 
-            ROOT::RDF::RNode filter = mainNode.Filter(this->systematicFilter(sample, isyst, ireg));
+            const std::string selection = this->systematicFilter(sample, isyst, ireg);
+            auto itr = uniqueFilters.at(regIndex).find(selection);
+            if (itr != uniqueFilters.at(regIndex).end()) {
+                LOG(VERBOSE) << "Region: " << ireg->name() << ", systematic: " << isyst->name() << " reuses an existing filter\n";
+                perSystFilter.emplace_back(itr->second);
+            } else {
+                ROOT::RDF::RNode filter = this->prefixTreeFilter(filterTree, selection);
+                filter = this->defineVariablesRegion(filter, sample, id, ireg->name());
+                uniqueFilters.at(regIndex).emplace(selection, filter);
+                perSystFilter.emplace_back(std::move(filter));
+            }
+            ++regIndex;
+        }
+        result.emplace_back(std::move(perSystFilter));
+    }
+
+    return result;
+}
+
+std::vector<std::vector<ROOT::RDF::RNode> > MainFrame::applyBitmaskFilters(ROOT::RDF::RNode mainNode,
+                                                                           const std::shared_ptr<Sample>& sample,
+                                                                           const UniqueSampleID& id) {
+
+    std::vector<std::vector<ROOT::RDF::RNode> > result;
+
+    const auto& regions = sample->regions();
+    const std::size_t nWords = (regions.size() + 63) / 64;
+
+    // systematics with the same selections in all regions share the bitmask columns
+    std::map<std::vector<std::string>, std::vector<std::string> > maskColumns;
+
+    // systematics that do not change the selection (e.g. weight-only) share the filter node, per region
+    std::vector<std::map<std::string, ROOT::RDF::RNode> > uniqueFilters(regions.size());
+
+    for (const auto& isyst : sample->systematics()) {
+        // empty selection for the skipped region-systematic combinations
+        std::vector<std::string> selections;
+        for (const auto& ireg : regions) {
+            if (sample->skipSystematicRegionCombination(isyst, ireg)) {
+                selections.emplace_back("");
+            } else {
+                selections.emplace_back(this->systematicFilter(sample, isyst, ireg));
+            }
+        }
+
+        auto itrMask = maskColumns.find(selections);
+        if (itrMask == maskColumns.end()) {
+            std::vector<std::string> columns;
+            for (std::size_t iword = 0; iword < nWords; ++iword) {
+                std::string definition;
+                for (std::size_t iregion = iword * 64; iregion < std::min(regions.size(), (iword + 1) * 64); ++iregion) {
+                    if (selections.at(iregion).empty()) continue;
+                    definition += definition.empty() ? "" : " | ";
+                    definition += "(static_cast<ULong64_t>(static_cast<bool>(" + selections.at(iregion) + ")) << " + std::to_string(iregion % 64) + ")";
+                }
+                if (definition.empty()) definition = "0";
+
+                const std::string name = "regionBitmask_" + std::to_string(maskColumns.size()) + "_" + std::to_string(iword);
+                mainNode = this->defineWithCache(mainNode, name, "static_cast<ULong64_t>(" + definition + ")");
+                columns.emplace_back(name);
+            }
+            LOG(DEBUG) << "Systematic: " << isyst->name() << " uses new region bitmask column(s)\n";
+            itrMask = maskColumns.emplace(selections, columns).first;
+        }
+
+        std::vector<ROOT::RDF::RNode> perSystFilter;
+        for (std::size_t iregion = 0; iregion < regions.size(); ++iregion) {
+            const auto& ireg = regions.at(iregion);
+            const std::string& selection = selections.at(iregion);
+            if (selection.empty()) {
+                LOG(DEBUG) << "Skipping region: " << ireg->name() << ", systematic: " << isyst->name() << " combination for sample: " << sample->name() << " (filter)\n";
+                continue;
+            }
+
+            auto itr = uniqueFilters.at(iregion).find(selection);
+            if (itr != uniqueFilters.at(iregion).end()) {
+                LOG(VERBOSE) << "Region: " << ireg->name() << ", systematic: " << isyst->name() << " reuses an existing filter\n";
+                perSystFilter.emplace_back(itr->second);
+                continue;
+            }
+
+            const ULong64_t bit = 1ULL << (iregion % 64);
+            ROOT::RDF::RNode filter = mainNode.Filter([bit](const ULong64_t mask){return (mask & bit) != 0;},
+                                                      {itrMask->second.at(iregion / 64)});
             filter = this->defineVariablesRegion(filter, sample, id, ireg->name());
+            uniqueFilters.at(iregion).emplace(selection, filter);
             perSystFilter.emplace_back(std::move(filter));
         }
         result.emplace_back(std::move(perSystFilter));
@@ -650,10 +999,36 @@ ROOT::RDF::RNode MainFrame::addSingleWeightColumn(ROOT::RDF::RNode mainNode,
 
     m_systReplacer.addSingleSystematic("weight_total_NOSYS", systematic->name());
 
-    auto node = mainNode.Define(systName, formula);
+    // use the compiled product of the columns when possible to avoid JIT compilation of each systematic
+    // the nominal weight is parsed once, only its columns are replaced for the systematic
+    const WeightExpression& nominalExpression = this->weightExpression(nominalWeight);
+    std::vector<std::string> systColumns;
+    for (const auto& icolumn : nominalExpression.columns()) {
+        systColumns.emplace_back(m_systReplacer.replaceString(icolumn, systematic));
+    }
+    WeightExpression expression = nominalExpression.withColumns(systColumns, m_systReplacer.replaceString(nominalWeight, systematic))
+                                                   .multiply(this->weightExpression(normalisation));
+    if (!systematic->weightSuffix().empty()) {
+        expression = expression.multiply(this->weightExpression(systematic->weightSuffix()));
+    }
+    if (expression.isCompilable(mainNode)) {
+        LOG(VERBOSE) << "Weight: " << systName << " is defined as a compiled product of " << expression.columns().size() << " columns\n";
+        return expression.define(mainNode, systName);
+    }
+
+    auto node = this->defineWithCache(mainNode, systName, formula);
     return node;
 }
 
+const WeightExpression& MainFrame::weightExpression(const std::string& formula) {
+    auto itr = m_weightExpressions.find(formula);
+    if (itr == m_weightExpressions.end()) {
+        itr = m_weightExpressions.emplace(formula, WeightExpression(formula)).first;
+    }
+
+    return itr->second;
+}
+
 ROOT::RDF::RNode MainFrame::addTLorentzVectors(ROOT::RDF::RNode mainNode) {
     const std::vector<std::string>& objects = m_config->tLorentzVectors();
     for (const auto& iobject : objects) {
@@ -716,7 +1091,8 @@ ROOT::RDF::RNode MainFrame::addSingleTLorentzVector(ROOT::RDF::RNode mainNode,
 }
 
 std::vector<SystematicHisto> MainFrame::processHistograms(std::vector<std::vector<ROOT::RDF::RNode> >& filters,
-                                                          const std::shared_ptr<Sample>& sample) {
+                                                          const std::shared_ptr<Sample>& sample,
+                                                          const PackedHistoContainer& packedHistos) {
 
     std::vector<SystematicHisto> result;
 
@@ -724,18 +1100,18 @@ std::vector<SystematicHisto> MainFrame::processHistograms(std::vector<std::vecto
     for (const auto& isyst : sample->systematics()) {
         SystematicHisto systematicHisto(isyst->name());
 
-        std::size_t regIndex(0);
+        // skipped regions do not have a filter
+        std::size_t filterIndex(0);
         for (const auto& ireg : sample->regions()) {
             if (sample->skipSystematicRegionCombination(isyst, ireg)) {
                 LOG(DEBUG) << "Skipping region: " << ireg->name() << ", systematic: " << isyst->name() << " combination for sample: " << sample->name() << " (histogram)\n";
-                ++regIndex;
                 continue;
             }
             RegionHisto regionHisto(ireg->name());
 
-            ROOT::RDF::RNode node = filters.at(systIndex).at(regIndex);
+            ROOT::RDF::RNode node = filters.at(systIndex).at(filterIndex);
 
-            this->processHistograms1D(&regionHisto, node, sample, ireg, isyst);
+            this->processHistograms1D(&regionHisto, node, sample, ireg, isyst, packedHistos);
 
             this->processHistograms2D(&regionHisto, node, sample, ireg, isyst);
 
@@ -744,7 +1120,7 @@ std::vector<SystematicHisto> MainFrame::processHistograms(std::vector<std::vecto
             this->processHistograms3D(&regionHisto, node, sample, ireg, isyst);
 
             systematicHisto.addRegionHisto(std::move(regionHisto));
-            ++regIndex;
+            ++filterIndex;
         }
         result.emplace_back(std::move(systematicHisto));
         ++systIndex;
@@ -753,6 +1129,161 @@ std::vector<SystematicHisto> MainFrame::processHistograms(std::vector<std::vecto
     return result;
 }
 
+PackedHistoContainer MainFrame::bookPackedHistos1D(ROOT::RDF::RNode mainNode,
+                                                  const std::vector<std::vector<ROOT::RDF::RNode> >& filters,
+                                                  const std::shared_ptr<Sample>& sample,
+                                                  const UniqueSampleID& id) {
+
+    PackedHistoContainer result;
+
+    const std::vector<std::string>& sampleVariables = sample->variables();
+
+    // index of the current region in the filters for each systematic (skipped regions do not have a filter)
+    std::vector<std::size_t> filterIndices(sample->systematics().size(), 0);
+
+    std::size_t regIndex(0);
+    for (const auto& ireg : sample->regions()) {
+        std::vector<std::shared_ptr<Systematic> > systematics;
+        std::shared_ptr<Systematic> nominal(nullptr);
+        std::unique_ptr<ROOT::RDF::RNode> nominalNode(nullptr);
+        for (std::size_t isyst = 0; isyst < sample->systematics().size(); ++isyst) {
+            const auto& systematic = sample->systematics().at(isyst);
+            if (sample->skipSystematicRegionCombination(systematic, ireg)) continue;
+            if (systematic->name() == "NOSYS") {
+                nominal = systematic;
+                nominalNode = std::make_unique<ROOT::RDF::RNode>(filters.at(isyst).at(filterIndices.at(isyst)));
+            }
+            systematics.emplace_back(systematic);
+            ++filterIndices.at(isyst);
+        }
+
+        std::vector<const Variable*> variables;
+        for (const auto& ivariable : ireg->variables()) {
+            if (ivariable.isNominalOnly() || !ivariable.hasScalarType()) continue;
+            if (std::find(sampleVariables.begin(), sampleVariables.end(), ivariable.name()) == sampleVariables.end()) continue;
+            variables.emplace_back(&ivariable);
+        }
+
+        // nothing to gain
+        if (systematics.size() < 2 || variables.empty()) {
+            ++regIndex;
+            continue;
+        }
+
+        std::vector<std::string> selections;
+        std::vector<std::string> uniqueSelections;
+        for (const auto& isyst : systematics) {
+            selections.emplace_back(this->systematicFilter(sample, isyst, ireg));
+            if (std::find(uniqueSelections.begin(), uniqueSelections.end(), selections.back()) == uniqueSelections.end()) {
+                uniqueSelections.emplace_back(selections.back());
+            }
+        }
+        const std::string nominalSelection = nominalNode ? this->systematicFilter(sample, nominal, ireg) : "";
+
+        const std::string prefix = "packedSystematics_" + std::to_string(regIndex) + "_";
+
+        // Node for the systematics that change the selection or the variable:
+        // only events passing at least one of the systematic selections are processed
+        std::unique_ptr<ROOT::RDF::RNode> systNode(nullptr);
+        if (uniqueSelections.size() == 1 && nominalNode) {
+            systNode = std::make_unique<ROOT::RDF::RNode>(*nominalNode);
+        } else {
+            std::string orSelection;
+            for (const auto& iselection : uniqueSelections) {
+                orSelection += orSelection.empty() ? "" : "||";
+                orSelection += "(" + iselection + ")";
+            }
+            systNode = std::make_unique<ROOT::RDF::RNode>(this->filterWithCache(mainNode, orSelection));
+            *systNode = this->defineVariablesRegion(*systNode, sample, id, ireg->name());
+        }
+
+        // the packed columns are only defined once for the same content
+        std::map<std::vector<std::string>, std::string> nominalColumns;
+        std::map<std::vector<std::string>, std::string> systColumns;
+        auto packedColumn = [this, &prefix](ROOT::RDF::RNode& node,
+                                            std::map<std::vector<std::string>, std::string>& columns,
+                                            const std::string& nodeName,
+                                            const std::string& type,
+                                            const std::vector<std::string>& elements,
+                                            const std::string& flagsColumn = "") {
+            std::vector<std::string> key = elements;
+            key.emplace_back(flagsColumn);
+            auto itr = columns.find(key);
+            if (itr != columns.end()) return itr->second;
+
+            const std::string name = prefix + nodeName + "_" + std::to_string(columns.size());
+            node = this->defineWithCache(node, name, Utils::packedColumnDefinition(type, elements, flagsColumn));
+            columns.emplace(std::move(key), name);
+            return name;
+        };
+
+        for (const Variable* ivariable : variables) {
+            const std::string nominalVariable = nominal ? this->systematicVariable(*ivariable, nominal) : "";
+
+            // systematics that only change the weight are filled on the nominal node with the nominal value
+            std::vector<std::string> weightOnlyNames;
+            std::vector<std::string> weightOnlyWeights;
+            std::vector<std::string> systNames;
+            std::vector<std::string> systSelections;
+            std::vector<std::string> systWeights;
+            std::vector<std::string> systValues;
+            for (std::size_t isyst = 0; isyst < systematics.size(); ++isyst) {
+                const std::string systVariable = this->systematicVariable(*ivariable, systematics.at(isyst));
+                if (nominalNode && selections.at(isyst) == nominalSelection && systVariable == nominalVariable) {
+                    weightOnlyNames.emplace_back(systematics.at(isyst)->name());
+                    weightOnlyWeights.emplace_back(this->systematicWeight(systematics.at(isyst)));
+                } else {
+                    systNames.emplace_back(systematics.at(isyst)->name());
+                    systSelections.emplace_back(selections.at(isyst));
+                    systWeights.emplace_back(this->systematicWeight(systematics.at(isyst)));
+                    systValues.emplace_back(systVariable);
+                }
+            }
+
+            if (weightOnlyNames.size() > 1) {
+                const std::string valueName = prefix + "nominalValue_" + ivariable->name();
+                if (!nominalNode->HasColumn(valueName)) {
+                    *nominalNode = this->defineWithCache(*nominalNode, valueName, "static_cast<double>(" + nominalVariable + ")");
+                }
+                const std::string weightsName = packedColumn(*nominalNode, nominalColumns, "nominalWeights", "double", weightOnlyWeights);
+
+                SystematicHisto1DHelper helper(ivariable->histoModel1D(), weightOnlyNames.size(), nominalNode->GetNSlots());
+                ROOT::RDF::RResultPtr<std::vector<TH1D> > histos =
+                    nominalNode->Book<double, RVec<double> >(std::move(helper), {valueName, weightsName});
+
+                result.addHistos(ireg->name(), ivariable->name(), histos, weightOnlyNames);
+            } else {
+                // not worth a separate action
+                for (std::size_t i = 0; i < weightOnlyNames.size(); ++i) {
+                    systNames.emplace_back(weightOnlyNames.at(i));
+                    systSelections.emplace_back(nominalSelection);
+                    systWeights.emplace_back(weightOnlyWeights.at(i));
+                    systValues.emplace_back(nominalVariable);
+                }
+            }
+
+            if (systNames.size() > 1) {
+                // the values and weights are only evaluated for the variations whose selection passed,
+                // the expressions may not be valid otherwise (e.g. guarded accesses to the elements of a vector)
+                const std::string selectionName = packedColumn(*systNode, systColumns, "passed", "bool", systSelections);
+                const std::string valuesName    = packedColumn(*systNode, systColumns, "values", "double", systValues, selectionName);
+                const std::string weightsName   = packedColumn(*systNode, systColumns, "weights", "double", systWeights, selectionName);
+
+                SystematicHisto1DHelper helper(ivariable->histoModel1D(), systNames.size(), systNode->GetNSlots());
+                ROOT::RDF::RResultPtr<std::vector<TH1D> > histos =
+                    systNode->Book<RVec<double>, RVec<double>, RVec<bool> >(std::move(helper), {valuesName, weightsName, selectionName});
+
+                result.addHistos(ireg->name(), ivariable->name(), histos, systNames);
+            }
+        }
+
+        LOG(DEBUG) << "Booked packed 1D histograms for region: " << ireg->name() << ", with " << systematics.size() << " systematics and " << variables.size() << " variables\n";
+        ++regIndex;
+    }
+
+    return result;
+}
+
 void MainFrame::writeHistosToFile(const std::vector<SystematicHisto>& histos,
                                   const std::vector<VariableHisto>& truthHistos,
                                   std::vector<CutflowContainer>& cutflowHistos,
@@ -779,6 +1310,20 @@ void MainFrame::writeHistosToFile(const std::vector<SystematicHisto>& histos,
         throw std::invalid_argument("");
     }
 
+    // the processed entry ranges are checked when merging the outputs of the jobs
+    auto itrRanges = m_jobEntryRanges.find(sample->name());
+    if (itrRanges != m_jobEntryRanges.end()) {
+        TNamed ranges("job_entry_ranges", Utils::entryRangesToString(itrRanges->second).c_str());
+        out->cd();
+        ranges.Write();
+    }
+    auto itrInput = m_jobInputRanges.find(sample->name());
+    if (itrInput != m_jobInputRanges.end()) {
+        TNamed input("job_input_ranges", Utils::entryRangesToString(itrInput->second).c_str());
+        out->cd();
+        input.Write();
+    }
+
     LOG(INFO) << "Writing histograms to file: " << fileName << "\n";
     if (allUniqueSamples) {
         LOG(INFO) << "Triggering event loop!\n";
@@ -811,7 +1356,7 @@ void MainFrame::writeHistosToFile(const std::vector<SystematicHisto>& histos,
                     out->cd(isystHist.name().c_str());
                 }
                 if (allUniqueSamples) {
-                    ivariableHist.histo()->Write(histoName.c_str());
+                    ivariableHist.histoPtr()->Write(histoName.c_str());
                 } else {
                     ivariableHist.histoUniquePtr()->Write(histoName.c_str());
                 }
@@ -861,6 +1406,19 @@ void MainFrame::writeHistosToFile(const std::vector<SystematicHisto>& histos,
             }
             const std::string histoName = "Cutflow_" + icutflow.name();
             hist->Write(histoName.c_str());
+
+            if (!icutflow.hasSystematics()) continue;
+
+            std::unique_ptr<TH2D> systHist(nullptr);
+            if (allUniqueSamples) {
+                CutflowContainer values(icutflow.name());
+                values.copyValues(icutflow);
+                systHist = values.systematicCutflowHisto();
+            } else {
+                systHist = icutflow.systematicCutflowHisto();
+            }
+            out->cd();
+            systHist->Write((histoName + "_systematics").c_str());
         }
     }
 
@@ -981,7 +1539,8 @@ void MainFrame::processHistograms1D(RegionHisto* regionHisto,
                                     const ROOT::RDF::RNode& node,
                                     const std::shared_ptr<Sample>& sample,
                                     const std::shared_ptr<Region>& region,
-                                    const std::shared_ptr<Systematic>& systematic) const {
+                                    const std::shared_ptr<Systematic>& systematic,
+                                    const PackedHistoContainer& packedHistos) const {
 
     for (const auto& ivariable : region->variables()) {
         const std::vector<std::string>& variables = sample->variables();
@@ -995,6 +1554,12 @@ void MainFrame::processHistograms1D(RegionHisto* regionHisto,
         }
         VariableHisto variableHisto(ivariable.name());
 
+        // use the histogram booked together with the other systematics if available
+        if (packedHistos.setPackedHisto(&variableHisto, region->name(), systematic->name())) {
+            regionHisto->addVariableHisto(std::move(variableHisto));
+            continue;
+        }
+
         ROOT::RDF::RResultPtr<TH1D> histogram = this->book1Dhisto(node, ivariable, systematic);
 
         if (!histogram) {
@@ -1138,11 +1703,11 @@ void MainFrame::processHistograms3D(RegionHisto* regionHisto,
     }
 }
 
-std::vector<std::pair<std::unique_ptr<TChain>, std::unique_ptr<TTreeIndex> > > MainFrame::connectTruthTrees(std::unique_ptr<TChain>& chain,
+std::vector<std::pair<std::unique_ptr<TChain>, std::unique_ptr<TVirtualIndex> > > MainFrame::connectTruthTrees(std::unique_ptr<TChain>& chain,
                                                                                                             const std::shared_ptr<Sample>& sample,
                                                                                                             const std::vector<std::string>& filePaths) {
 
-    std::vector<std::pair<std::unique_ptr<TChain>, std::unique_ptr<TTreeIndex> > > result;
+    std::vector<std::pair<std::unique_ptr<TChain>, std::unique_ptr<TVirtualIndex> > > result;
 
     static const std::vector<std::string> patternToCheck = {"el_.*", "mu_.*", "tau_.*", "jet_.*", "ph_.*", "ljet_.*"};
 
@@ -1156,6 +1721,10 @@ std::vector<std::pair<std::unique_ptr<TChain>, std::unique_ptr<TTreeIndex> > > M
 
         LOG(INFO) << "Attaching tree: " << itruth << " to the reco tree\n";
         std::unique_ptr<TChain> truthChain = Utils::chainFromFiles(itruth, filePaths);
+        if (!chain || !truthChain) {
+            LOG(ERROR) << "Matching reco and truth trees uses friend trees and is only supported for TTree inputs, not for RNTuple\n";
+            throw std::invalid_argument("");
+        }
 
         const std::vector<std::string> branchConflicts = Utils::matchingBranchesFromChains(chain, truthChain, patternToCheck);
 
@@ -1178,24 +1747,15 @@ std::vector<std::pair<std::unique_ptr<TChain>, std::unique_ptr<TTreeIndex> > > M
         }
         m_systReplacer.addTruthBranchesNominal(itruth, listOfTruthBranches);
 
-        std::unique_ptr<TTreeIndex> t(nullptr);
-        if (indexNames.size() == 1 ) {
+        // the keys of the truth tree are read in parallel and kept as one sorted array
+        const std::string minorName = indexNames.size() == 1 ? "0" : indexNames.at(1);
+        if (indexNames.size() == 1) {
             LOG(INFO) << "Building reco truth index with: " << indexNames.at(0) << "\n";
-            t = std::make_unique<TTreeIndex>(truthChain.get(), indexNames.at(0).c_str(), "0");
-            if (t->IsZombie()) {
-                LOG(ERROR) << "The TTreeIndex is a zombie!\n";
-                throw std::runtime_error("");
-            }
-            truthChain->SetTreeIndex(t.get());
         } else {
             LOG(INFO) << "Building reco truth index with: " << indexNames.at(0) << " and " << indexNames.at(1) << "\n";
-            t = std::make_unique<TTreeIndex>(truthChain.get(), indexNames.at(0).c_str(), indexNames.at(1).c_str());
-            if (t->IsZombie()) {
-                LOG(ERROR) << "The TTreeIndex is a zombie!\n";
-                throw std::runtime_error("");
-            }
-            truthChain->SetTreeIndex(t.get());
         }
+        std::unique_ptr<TVirtualIndex> t = std::make_unique<SortedTreeIndex>(truthChain.get(), itruth, filePaths, indexNames.at(0), minorName, m_config->cacheTruthIndex());
+        truthChain->SetTreeIndex(t.get());
         chain->AddFriend(truthChain.get());
         result.emplace_back(std::make_pair(std::move(truthChain), std::move(t)));
     }
@@ -1205,12 +1765,13 @@ std::vector<std::pair<std::unique_ptr<TChain>, std::unique_ptr<TTreeIndex> > > M
 
 std::vector<VariableHisto> MainFrame::processTruthHistos(const std::vector<std::string>& filePaths,
                                                          const std::shared_ptr<Sample>& sample,
-                                                         const UniqueSampleID& id) {
+                                                         const UniqueSampleID& id,
+                                                         const bool rejectAllEvents) {
 
     std::vector<VariableHisto> result;
 
     // prepare truth nodes with weights and custom definitions
-    std::map<std::string, ROOT::RDF::RNode> rdfNodes = this->prepareTruthNodes(filePaths, sample, id);
+    std::map<std::string, ROOT::RDF::RNode> rdfNodes = this->prepareTruthNodes(filePaths, sample, id, rejectAllEvents);
 
     // apply filters and book histograms
     for (const auto& itruth : sample->truths()) {
@@ -1338,7 +1899,7 @@ ROOT::RDF::RNode MainFrame::systematicStringDefine(ROOT::RDF::RNode mainNode,
     }
 
     // add nominal
-    mainNode = mainNode.Define(name, formula);
+    mainNode = this->defineWithCache(mainNode, name, formula);
 
     // first find on which variables the formula depends that are affected by systematics
     const std::vector<std::string> affectedVariables = m_systReplacer.listOfVariablesAffected(formula);
@@ -1352,7 +1913,7 @@ ROOT::RDF::RNode MainFrame::systematicStringDefine(ROOT::RDF::RNode mainNode,
         const std::string newFormula = m_systReplacer.replaceString(formula, isyst);
         LOG(VERBOSE) << "Adding custom variable using strings: " << newName << ", formula: " << newFormula << "\n";
 
-        mainNode = mainNode.Define(newName, newFormula);
+        mainNode = this->defineWithCache(mainNode, newName, newFormula);
 
     }
     m_systReplacer.addVariableAndEffectiveSystematics(name, systematicList);
@@ -1384,7 +1945,7 @@ ROOT::RDF::RNode MainFrame::systematicStringRedefine(ROOT::RDF::RNode mainNode,
     }
 
     // redefine nominal
-    mainNode = mainNode.Redefine(name, formula);
+    mainNode = this->defineWithCache(mainNode, name, formula, true);
 
     // find systematics that could affect the result of this formula
     const std::vector<std::string> affectedVariables = m_systReplacer.listOfVariablesAffected(formula);
@@ -1401,9 +1962,9 @@ ROOT::RDF::RNode MainFrame::systematicStringRedefine(ROOT::RDF::RNode mainNode,
         // it is possible that redefining the variable changes systematics, so
         // we have to check if we need Define() or Redefine() here too
         if (std::find(columnNames.begin(), columnNames.end(), systName) == columnNames.end()) {
-            mainNode = mainNode.Define(systName, systFormula);
+            mainNode = this->defineWithCache(mainNode, systName, systFormula);
         } else {
-            mainNode = mainNode.Redefine(systName, systFormula);
+            mainNode = this->defineWithCache(mainNode, systName, systFormula, true);
         }
     }
 
@@ -1419,7 +1980,7 @@ ROOT::RDF::RNode MainFrame::addCustomTruthDefinesFromConfig(ROOT::RDF::RNode mai
 
     for (const auto& idefine : sample->customTruthDefines()) {
         if (treeName != idefine->treeName()) continue;
-        mainNode = mainNode.Define(idefine->columnName(), idefine->formula());
+        mainNode = this->defineWithCache(mainNode, idefine->columnName(), idefine->formula());
     }
 
     return mainNode;
@@ -1553,42 +2114,99 @@ ROOT::RDF::RResultPtr<TH3D> MainFrame::book3Dhisto(ROOT::RDF::RNode node,
 }
 
 std::vector<CutflowContainer> MainFrame::bookCutflows(ROOT::RDF::RNode node,
-                                                      const std::shared_ptr<Sample>& sample) const {
+                                                      const std::shared_ptr<Sample>& sample) {
 
     std::vector<CutflowContainer> result;
 
     if (!sample->hasCutflows()) return result;
 
-    // add weight squared for stat uncertainty
-    node = node.Define("weight_total_squared_NOSYS", [](const double weight){return weight*weight;}, {"weight_total_NOSYS"});
-
+    std::size_t cutflowIndex(0);
     for (const auto& cutflow : sample->cutflows()) {
         CutflowContainer container(cutflow->name());
 
-        // add initial set
-        auto initialWeight        = node.Sum("weight_total_NOSYS");
-        auto initialWeightSquared = node.Sum("weight_total_squared_NOSYS");
-        container.addBookedYields(initialWeight, initialWeightSquared, "Initial");
-
-        auto filteredNode = node;
+        std::vector<std::string> titles{"Initial"};
+        std::vector<std::string> selections;
 
         // add sample suffix, if it exists
         if (!sample->selectionSuffix().empty()) {
-            filteredNode             = filteredNode.Filter(sample->selectionSuffix());
-            auto suffixWeight        = filteredNode.Sum("weight_total_NOSYS");
-            auto suffixWeightSquared = filteredNode.Sum("weight_total_squared_NOSYS");
-            container.addBookedYields(suffixWeight, suffixWeightSquared, "SuffixSelection");
+            titles.emplace_back("SuffixSelection");
+            selections.emplace_back(sample->selectionSuffix());
         }
 
         for (const auto& iselection : cutflow->selections()) {
-            const std::string& finalSelection = iselection.first;
-            filteredNode       = filteredNode.Filter(finalSelection);
-            auto weight        = filteredNode.Sum("weight_total_NOSYS");
-            auto weightSquared = filteredNode.Sum("weight_total_squared_NOSYS");
-            container.addBookedYields(weight, weightSquared, iselection.second);
+            titles.emplace_back(iselection.second);
+            selections.emplace_back(iselection.first);
         }
 
+        // number of consecutive steps passed by the event,
+        // a selection is not evaluated for events failing the previous ones
+        auto passedSteps = [](const std::vector<std::string>& stepSelections) {
+            std::string result;
+            for (std::size_t istep = 0; istep < stepSelections.size(); ++istep) {
+                result += "!(" + stepSelections.at(istep) + ") ? " + std::to_string(istep + 1) + " : ";
+            }
+            return "static_cast<int>(" + result + std::to_string(stepSelections.size() + 1) + ")";
+        };
+
+        const std::string prefix = "cutflowPassedSteps_" + std::to_string(cutflowIndex);
+        ROOT::RDF::RNode cutflowNode = this->defineWithCache(node, prefix, passedSteps(selections));
+
+        if (!cutflow->systematics() || sample->nominalOnly()) {
+            CutflowHelper helper(titles.size(), cutflowNode.GetNSlots());
+            ROOT::RDF::RResultPtr<std::vector<double> > sums =
+                cutflowNode.Book<int, double>(std::move(helper), {prefix, "weight_total_NOSYS"});
+            container.addBookedSums(sums, titles);
+
+            result.emplace_back(std::move(container));
+            ++cutflowIndex;
+            continue;
+        }
+
+        // the nominal goes first, it is also stored as the nominal cutflow
+        std::vector<std::shared_ptr<Systematic> > systematics;
+        for (const auto& isyst : sample->systematics()) {
+            if (isyst->isNominal()) systematics.insert(systematics.begin(), isyst);
+            else systematics.emplace_back(isyst);
+        }
+        if (systematics.empty() || !systematics.front()->isNominal()) {
+            LOG(ERROR) << "Nominal systematic is needed for the systematic cutflow: " << cutflow->name() << "\n";
+            throw std::invalid_argument("");
+        }
+
+        // the steps are evaluated once per distinct set of the systematic selections,
+        // the systematics that only change the weight reuse the nominal column
+        std::map<std::vector<std::string>, std::string> stepColumns{{selections, prefix}};
+        std::vector<std::string> systNames;
+        std::vector<std::string> systSteps;
+        std::vector<std::string> systWeights;
+        for (const auto& isyst : systematics) {
+            std::vector<std::string> systSelections;
+            for (const auto& iselection : selections) {
+                systSelections.emplace_back(m_systReplacer.replaceString(iselection, isyst));
+            }
+            auto itr = stepColumns.find(systSelections);
+            if (itr == stepColumns.end()) {
+                const std::string columnName = prefix + "_" + std::to_string(stepColumns.size());
+                cutflowNode = this->defineWithCache(cutflowNode, columnName, passedSteps(systSelections));
+                itr = stepColumns.emplace(systSelections, columnName).first;
+            }
+            systNames.emplace_back(isyst->name());
+            systSteps.emplace_back(itr->second);
+            systWeights.emplace_back(this->systematicWeight(isyst));
+        }
+
+        const std::string stepsName   = prefix + "_packedSteps";
+        const std::string weightsName = prefix + "_packedWeights";
+        cutflowNode = this->defineWithCache(cutflowNode, stepsName, Utils::packedColumnDefinition("int", systSteps));
+        cutflowNode = this->defineWithCache(cutflowNode, weightsName, Utils::packedColumnDefinition("double", systWeights));
+
+        CutflowHelper helper(titles.size(), cutflowNode.GetNSlots(), systNames.size());
+        ROOT::RDF::RResultPtr<std::vector<double> > sums =
+            cutflowNode.Book<RVec<int>, RVec<double> >(std::move(helper), {stepsName, weightsName});
+        container.addBookedSums(sums, titles, systNames);
+
         result.emplace_back(std::move(container));
+        ++cutflowIndex;
     }
 
     return result;
@@ -1695,7 +2313,8 @@ ROOT::RDF::RNode MainFrame::addTruthVariablesToReco(ROOT::RDF::RNode node,
 
 std::map<std::string, ROOT::RDF::RNode> MainFrame::prepareTruthNodes(const std::vector<std::string>& filePaths,
                                                                      const std::shared_ptr<Sample>& sample,
-                                                                     const UniqueSampleID& id) {
+                                                                     const UniqueSampleID& id,
+                                                                     const bool rejectAllEvents) {
 
     std::map<std::string, ROOT::RDF::RNode> result;
 
@@ -1711,6 +2330,10 @@ std::map<std::string, ROOT::RDF::RNode> MainFrame::prepareTruthNodes(const std::
 
         mainNode = this->minMaxRange(mainNode);
 
+        if (rejectAllEvents) {
+            mainNode = mainNode.Filter([](){return false;}, {});
+        }
+
         mainNode = this->prepareWeightMetadata(mainNode, sample, id);
 
         // add weight columns
@@ -1755,7 +2378,7 @@ std::map<std::string, ROOT::RDF::RNode> MainFrame::prepareTruthNodes(const std::
 
 void MainFrame::processSingleTruthTreeNtuple(const std::shared_ptr<Truth>& truth,
                                              const std::vector<std::string>& filePaths,
-                                             const std::string& outputFilePath,
+                                             const std::vector<std::string>& outputPaths,
                                              const std::shared_ptr<Sample>& sample,
                                              const UniqueSampleID& id) {
 
@@ -1763,7 +2386,7 @@ void MainFrame::processSingleTruthTreeNtuple(const std::shared_ptr<Truth>& truth
 
     auto chain = Utils::chainFromFiles(truth->truthTreeName(), filePaths);
 
-    ROOT::RDataFrame df(*chain);
+    ROOT::RDataFrame df = Utils::dataFrameFromFiles(truth->truthTreeName(), filePaths, chain);
 
     ROOT::RDF::RNode mainNode = df;
     #if ROOT_VERSION_CODE > ROOT_VERSION(6,29,0)
@@ -1797,7 +2420,17 @@ void MainFrame::processSingleTruthTreeNtuple(const std::shared_ptr<Truth>& truth
     opts.fAutoFlush = m_config->ntupleAutoFlush();
     opts.fCompressionLevel = m_config->ntupleCompressionLevel();
     opts.fVector2RVec = m_config->configDefineAfterCustomClass();
-    mainNode.Snapshot(truth->name(), outputFilePath, branches, opts);
+    opts.fLazy = true;
+    Utils::setSnapshotFormat(opts, m_config->ntupleFormat());
+    std::vector<ROOT::RDF::RResultPtr<ROOT::RDF::RInterface<ROOT::Detail::RDF::RLoopManager> > > snapshots;
+    for (const auto& ipath : outputPaths) {
+        snapshots.emplace_back(mainNode.Snapshot(truth->name(), ipath, branches, opts));
+    }
+
+    // one event loop writes all the outputs
+    for (auto& isnapshot : snapshots) {
+        isnapshot.GetValue();
+    }
 }
 
 ROOT::RDF::RNode MainFrame::addVariablesWithFormulaReco(ROOT::RDF::RNode node,
@@ -1825,7 +2458,7 @@ ROOT::RDF::RNode MainFrame::addVariablesWithFormulaTruth(ROOT::RDF::RNode node,
 
     for (const auto& [formula, name] : map) {
         LOG(DEBUG) << "Adding column: " << name << " with formula: " << formula << " from truth tree: " << treeName << " to the reco tree\n";
-        outNode = outNode.Define(name, formula);
+        outNode = this->defineWithCache(outNode, name, formula);
     }
 
     m_variablesWithFormulaTruth.insert({treeName, map   });
@@ -1834,7 +2467,85 @@ ROOT::RDF::RNode MainFrame::addVariablesWithFormulaTruth(ROOT::RDF::RNode node,
 }
 
 void MainFrame::prepareONNXwrapper() {
+    // every processing slot gets its own sessions
+    const unsigned int nSlots = std::max(ROOT::GetThreadPoolSize(), 1u);
     for (const auto& infer : m_config->simpleONNXInferences()) {
-        infer->initializeModels();
+        infer->initializeModels(nSlots);
+    }
+}
+
+ROOT::RDF::RNode MainFrame::defineWithCache(ROOT::RDF::RNode node,
+                                            const std::string& name,
+                                            const std::string& formula,
+                                            const bool isRedefine) {
+
+    if (!m_config->compiledCodePath().empty()) {
+        ROOT::RDF::RNode compiled = node;
+        if (CompiledExpressions::instance().define(node, name, formula, isRedefine, &compiled)) return compiled;
+    }
+
+    if (!m_jitCache) {
+        return isRedefine ? node.Redefine(name, formula) : node.Define(name, formula);
+    }
+
+    ROOT::RDF::RNode cached = node;
+    if (m_jitCache->define(node, name, formula, isRedefine, &cached)) return cached;
+
+    ROOT::RDF::RNode result = isRedefine ? node.Redefine(name, formula) : node.Define(name, formula);
+    m_jitCache->addExpression(node, formula, result.GetColumnType(name), false);
+
+    return result;
+}
+
+ROOT::RDF::RNode MainFrame::prefixTreeFilter(std::map<std::vector<std::string>, ROOT::RDF::RNode>& filterTree,
+                                             const std::string& selection) {
+
+    std::vector<std::string> terms;
+    ROOT::RDF::RNode node = filterTree.at(terms);
+    for (const auto& iterm : StringOperations::splitConjunction(selection)) {
+        terms.emplace_back(iterm);
+        auto itr = filterTree.find(terms);
+        if (itr != filterTree.end()) {
+            node = itr->second;
+            continue;
+        }
+        node = this->filterWithCache(node, iterm);
+        filterTree.emplace(terms, node);
     }
+    LOG(VERBOSE) << "Selection: " << selection << " is applied as " << terms.size() << " filter(s)\n";
+
+    return node;
+}
+
+ROOT::RDF::RNode MainFrame::filterWithCache(ROOT::RDF::RNode node,
+                                            const std::string& selection) {
+
+    if (!m_config->compiledCodePath().empty()) {
+        ROOT::RDF::RNode compiled = node;
+        if (CompiledExpressions::instance().filter(node, selection, &compiled)) return compiled;
+    }
+
+    if (!m_jitCache) return node.Filter(selection);
+
+    ROOT::RDF::RNode cached = node;
+    if (m_jitCache->filter(node, selection, &cached)) return cached;
+
+    m_jitCache->addExpression(node, selection, "bool", true);
+
+    return node.Filter(selection);
+}
+
+void MainFrame::writeCompiledExpressions() {
+    if (m_jitCache) m_jitCache->write();
+
+    const std::string& path = m_config->compiledCodePath();
+    if (path.empty()) return;
+
+    if (!CompiledExpressions::instance().hasMissingExpressions()) {
+        LOG(INFO) << "All expressions were compiled ahead of time\n";
+        return;
+    }
+
+    LOG(INFO) << "Some expressions are missing in the compiled code, generating: " << path << ". It will be compiled in the next run\n";
+    CompiledExpressions::instance().writeSource(path);
 }
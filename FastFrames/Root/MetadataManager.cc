@@ -12,6 +12,9 @@
 #include "FastFrames/Utils.h"
 #include "FastFrames/XSectionManager.h"
 
+#include "RVersion.h"
+
+#include <algorithm>
 #include <fstream>
 #include <exception>
 
@@ -220,26 +223,73 @@ ROOT::RDF::Experimental::RDatasetSpec MetadataManager::dataSpec(const std::share
                                                                 const std::shared_ptr<ConfigSetting>& config) const {
 
     ROOT::RDF::Experimental::RDatasetSpec spec;
+    if (config->totalJobSplits() <= 0 || !config->splitJobsByEntries()) {
+        for (const auto& id : sample->uniqueSampleIDs()) {
+            std::vector<std::string> paths = this->filePaths(id);
+            if (config->totalJobSplits() > 0) {
+                paths = Utils::selectedFileList(paths, config->totalJobSplits(), config->currentJobIndex());
+            }
+            spec.AddSample(this->singleSampleInfo(sample, id, paths));
+        }
+
+        return spec;
+    }
+
+    // only the files with entries in the range of this job are added,
+    // the range is then global for the files that were added
+    const std::vector<Utils::FileEntryRange> ranges = this->entryRanges(sample, config);
+    long long nEntries(0);
+    for (const auto& irange : ranges) {
+        nEntries += irange.lastEntry - irange.firstEntry;
+    }
+    if (nEntries == 0) {
+        LOG(WARNING) << "Sample: " << sample->name() << " has no entries in this job, no UniqueSample is added\n";
+        return spec;
+    }
     for (const auto& id : sample->uniqueSampleIDs()) {
-        spec.AddSample(this->singleSampleInfo(sample, id, config));
+        std::vector<std::string> paths;
+        for (const auto& ipath : this->filePaths(id)) {
+            auto itr = std::find_if(ranges.begin(), ranges.end(), [&ipath](const auto& element){return element.path == ipath;});
+            if (itr != ranges.end()) paths.emplace_back(ipath);
+        }
+        // UniqueSamples without entries in the range of this job are not processed by it
+        if (paths.empty()) continue;
+        spec.AddSample(this->singleSampleInfo(sample, id, paths));
     }
+    spec.WithGlobalRange({ranges.front().firstEntry, ranges.front().firstEntry + nEntries});
 
     return spec;
 }
 
+std::vector<Utils::FileEntryRange> MetadataManager::entryRanges(const std::shared_ptr<Sample>& sample,
+                                                                const std::shared_ptr<ConfigSetting>& config) const {
+
+    std::vector<std::string> paths;
+    for (const auto& id : sample->uniqueSampleIDs()) {
+        const std::vector<std::string>& idPaths = this->filePaths(id);
+        paths.insert(paths.end(), idPaths.begin(), idPaths.end());
+    }
+
+    return Utils::selectedEntryRanges(paths, sample->recoTreeName(), config->totalJobSplits(), config->currentJobIndex());
+}
+
 ROOT::RDF::Experimental::RSample MetadataManager::singleSampleInfo(const std::shared_ptr<Sample>& sample,
                                                                    const UniqueSampleID& id,
-                                                                   const std::shared_ptr<ConfigSetting>& config) const {
+                                                                   const std::vector<std::string>& paths) const {
 
-
-    std::vector<std::string> paths = this->filePaths(id);
-    if (config->totalJobSplits() > 0) {
-        paths = Utils::selectedFileList(paths, config->totalJobSplits(), config->currentJobIndex());
-    }
     if (paths.empty()) {
         LOG(WARNING) << "UniqueSample: " << id << " has no files, will not produce output ntuple\n";
     }
 
+    // RDatasetSpec detects the RNTuple inputs itself, but only in newer ROOT versions
+    #if ROOT_VERSION_CODE < ROOT_VERSION(6,36,0)
+    if (Utils::isRNTuple(sample->recoTreeName(), paths)) {
+        LOG(ERROR) << "UniqueSample: " << id << " has RNTuple inputs, processing them with the RDatasetSpec requires ROOT 6.36 or newer\n";
+        LOG(ERROR) << "Please set split_processing_per_unique_samples to True\n";
+        throw std::invalid_argument("");
+    }
+    #endif
+
     ROOT::RDF::Experimental::RMetaData meta = this->sampleMetadata(sample, id);
 
     ROOT::RDF::Experimental::RSample result(sample->name(), sample->recoTreeName(), paths, meta);
@@ -0,0 +1,20 @@
+/**
+ * @file NtupleOutput.cc
+ * @brief Class storing the options of one output of the ntupling
+ *
+ */
+
+#include "FastFrames/NtupleOutput.h"
+#include "FastFrames/Utils.h"
+
+NtupleOutput::NtupleOutput(const std::string& name) noexcept :
+m_name(name),
+m_selection("true"),
+m_fileSuffix("_" + name)
+{
+}
+
+std::vector<std::string> NtupleOutput::listOfSelectedBranches(const std::vector<std::string>& allBranches) const {
+
+    return Utils::selectedNotExcludedElements(allBranches, m_branches, m_excludedBranches);
+}
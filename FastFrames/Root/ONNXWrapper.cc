@@ -6,15 +6,27 @@
 
 #include "FastFrames/ONNXWrapper.h"
 
-#include <numeric>
+#include "TSystem.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
 #include <functional>
+#include <future>
+#include <numeric>
 #include <sstream>
+#include <stdexcept>
 
 #ifdef ONNXRUNTIME_AVAILABLE
 
 ONNXWrapper::ONNXWrapper(
   const std::string& name,
-  const std::vector<std::string>& filepaths_model_cv) :
+  const std::vector<std::string>& filepaths_model_cv,
+  const unsigned n_slots,
+  const int intra_op_threads,
+  const int inter_op_threads,
+  const GraphOptimizationLevel optimization_level,
+  const std::string& optimized_model_directory) :
   m_model_name(name),
   m_env(std::make_shared<Ort::Env>(ORT_LOGGING_LEVEL_WARNING, "")),
   m_session_options(std::make_shared<Ort::SessionOptions>()),
@@ -23,21 +35,44 @@ ONNXWrapper::ONNXWrapper(
   std::stringstream ss;
 
   // any session options are set via this object
-  // use single thread (single CPU core) for the model evaluation
-  m_session_options->SetIntraOpNumThreads(1);
-  // ONNX can perform optimizations of the model graph to improve performance (ORT_ENABLE_EXTENDED)
-  m_session_options->SetGraphOptimizationLevel(GraphOptimizationLevel::ORT_ENABLE_EXTENDED);
-
-  // create the session and load model into memory
+  // by default, use single thread (single CPU core) for the model evaluation as every processing slot has its own sessions
+  m_session_options->SetIntraOpNumThreads(intra_op_threads);
+  m_session_options->SetInterOpNumThreads(inter_op_threads);
+  // ONNX can perform optimizations of the model graph to improve performance (ORT_ENABLE_EXTENDED by default)
+  m_session_options->SetGraphOptimizationLevel(optimization_level);
+
+  // create the sessions of the first slot and load model into memory
+  // the optimised models are written at this step if requested
+  m_sessions.resize(std::max(n_slots, 1u));
+  std::vector<std::string> paths_to_load;
   for (const auto& fpath_model : filepaths_model_cv) {
-    auto fp = fpath_model;
-    LOG(INFO) << "Load model from " << fp << "\n";
-    m_sessions.emplace_back(new Ort::Session(*m_env, fp.c_str(), *m_session_options));
+    std::shared_ptr<Ort::Session> session;
+    // the other slots use the optimised model written by the first session (if requested)
+    paths_to_load.emplace_back(createFirstSession(fpath_model, optimized_model_directory, optimization_level, session));
+    m_sessions.front().emplace_back(std::move(session));
+  }
+
+  // the other slots are loaded in parallel
+  if (m_sessions.size() > 1) {
+    LOG(INFO) << "Creating " << m_sessions.size() << " copies of the sessions for model: " << m_model_name << "\n";
+    std::vector<std::future<std::vector<std::shared_ptr<Ort::Session>>>> futures;
+    for (std::size_t islot = 1; islot < m_sessions.size(); ++islot) {
+      futures.emplace_back(std::async(std::launch::async, [this, &paths_to_load]() {
+        std::vector<std::shared_ptr<Ort::Session>> sessions;
+        for (const auto& fp : paths_to_load) {
+          sessions.emplace_back(new Ort::Session(*m_env, fp.c_str(), *m_session_options));
+        }
+        return sessions;
+      }));
+    }
+    for (std::size_t islot = 1; islot < m_sessions.size(); ++islot) {
+      m_sessions.at(islot) = futures.at(islot - 1).get();
+    }
   }
 
   // retrieve the list of input and output tensor names
   Ort::AllocatorWithDefaultOptions allocator;
-  Ort::Session* session = m_sessions.front().get();
+  Ort::Session* session = m_sessions.front().front().get();
   for (size_t inode = 0; inode < session->GetInputCount(); inode++) {
     m_input_name_index[ session->GetInputNameAllocated(inode, allocator).get() ] = inode;
     m_input_node_names.push_back(session->GetInputNameAllocated(inode, allocator).get());
@@ -81,7 +116,7 @@ ONNXWrapper::ONNXWrapper(
   for (long unsigned int i=0; i < m_input_shapes.size(); ++i){
     ss << session->GetInputNameAllocated(i, allocator).get() << ": " << "ndims = " << m_input_shapes[i].size();
 
-    Ort::TypeInfo type_info = m_sessions.front()->GetInputTypeInfo(i);
+    Ort::TypeInfo type_info = session->GetInputTypeInfo(i);
     auto tensor_info = type_info.GetTensorTypeAndShapeInfo();
     ONNXTensorElementDataType type = tensor_info.GetElementType();
     std::vector<int64_t> dims = tensor_info.GetShape();
@@ -108,7 +143,7 @@ ONNXWrapper::ONNXWrapper(
   for (long unsigned int i=0; i < m_output_shapes.size(); ++i){
     ss << session->GetOutputNameAllocated(i, allocator).get() << ": " << "ndims = " << m_output_shapes[i].size();
 
-    Ort::TypeInfo type_info = m_sessions.front()->GetOutputTypeInfo(i);
+    Ort::TypeInfo type_info = session->GetOutputTypeInfo(i);
     if (type_info.GetONNXType() == ONNXType::ONNX_TYPE_TENSOR) {
       auto tensor_info = type_info.GetTensorTypeAndShapeInfo();
       ONNXTensorElementDataType type = tensor_info.GetElementType();
@@ -126,4 +161,63 @@ ONNXWrapper::ONNXWrapper(
 
 } // ONNXWrapper::ONNXWrapper
 
+std::string ONNXWrapper::optimizedModelPath(const std::string& filepath_model,
+                                            const std::string& optimized_model_directory,
+                                            const GraphOptimizationLevel optimization_level) const {
+
+  if (optimized_model_directory.empty()) return "";
+
+  FileStat_t stat;
+  if (gSystem->GetPathInfo(filepath_model.c_str(), stat) != 0) {
+    LOG(ERROR) << "Cannot read the model file: " << filepath_model << "\n";
+    throw std::invalid_argument("");
+  }
+
+  const std::size_t pos = filepath_model.find_last_of('/');
+  const std::string file_name = pos == std::string::npos ? filepath_model : filepath_model.substr(pos + 1);
+
+  // any change of the original model, the optimisation or the runtime gives a new name
+  std::stringstream ss;
+  ss << optimized_model_directory << "/" << m_model_name << "_" << file_name
+     << "_size" << stat.fSize << "_mtime" << stat.fMtime
+     << "_level" << static_cast<int>(optimization_level)
+     << "_ortapi" << ORT_API_VERSION << ".optimized.onnx";
+
+  return ss.str();
+}
+
+std::string ONNXWrapper::createFirstSession(const std::string& filepath_model,
+                                            const std::string& optimized_model_directory,
+                                            const GraphOptimizationLevel optimization_level,
+                                            std::shared_ptr<Ort::Session>& session) const {
+
+  const std::string optimized_path = optimizedModelPath(filepath_model, optimized_model_directory, optimization_level);
+
+  // no caching requested or the optimised model exists, no need to optimise it again
+  if (optimized_path.empty() || std::ifstream(optimized_path).good()) {
+    const std::string& fp = optimized_path.empty() ? filepath_model : optimized_path;
+    LOG(INFO) << "Load model from " << fp << "\n";
+    session = std::make_shared<Ort::Session>(*m_env, fp.c_str(), *m_session_options);
+    return fp;
+  }
+
+  gSystem->mkdir(optimized_model_directory.c_str(), true);
+  const std::string temporary_path = optimized_path + ".tmp" + std::to_string(gSystem->GetPid());
+  Ort::SessionOptions options = m_session_options->Clone();
+  options.SetOptimizedModelFilePath(temporary_path.c_str());
+
+  LOG(INFO) << "Load model from " << filepath_model << "\n";
+  session = std::make_shared<Ort::Session>(*m_env, filepath_model.c_str(), options);
+
+  // the rename is atomic, a job running in parallel either sees the full model or no model
+  if (std::rename(temporary_path.c_str(), optimized_path.c_str()) != 0) {
+    LOG(WARNING) << "Cannot write the optimised model to: " << optimized_path << ", the original model will be used\n";
+    std::remove(temporary_path.c_str());
+    return filepath_model;
+  }
+
+  LOG(INFO) << "Optimised model written to: " << optimized_path << "\n";
+  return optimized_path;
+}
+
 #endif // ONNXRUNTIME_AVAILABLE
\ No newline at end of file
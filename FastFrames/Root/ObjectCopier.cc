@@ -7,6 +7,7 @@
 #include "FastFrames/ObjectCopier.h"
 
 #include "FastFrames/Logger.h"
+#include "FastFrames/Utils.h"
 
 #include "ROOT/RDataFrame.hxx"
 #include "TClass.h"
@@ -17,7 +18,9 @@
 #include "TNamed.h"
 #include "TROOT.h"
 
+#include <algorithm>
 #include <exception>
+#include <future>
 
 ObjectCopier::ObjectCopier(const std::vector<std::string>& fileList) noexcept :
 m_fileList(fileList)
@@ -41,7 +44,8 @@ void ObjectCopier::readObjectInfo() {
         const std::string classname = key->GetClassName();
         const TClass *cl = gROOT->GetClass(classname.c_str());
         if (!cl) continue;
-        if (cl->InheritsFrom("TTree")) {
+        // RNTuples are copied the same way as trees
+        if (cl->InheritsFrom("TTree") || classname == "ROOT::RNTuple" || classname == "ROOT::Experimental::RNTuple") {
             m_objectList.emplace_back(std::make_pair(key->GetName(), ObjectCopier::ObjectType::Tree));
             continue;
         }
@@ -57,85 +61,133 @@ void ObjectCopier::readObjectInfo() {
 }
 
 void ObjectCopier::copyObjectsTo(const std::string& outputPath) const {
-    std::vector<std::unique_ptr<TFile> > files;
-    for (const auto& ifile : m_fileList) {
-        std::unique_ptr<TFile> f(TFile::Open(ifile.c_str(), "READ"));
-        if (!f) {
-            LOG(ERROR) << "Cannot open file at: " << ifile << "\n";
+    this->copyObjectsTo(std::vector<std::string>{outputPath});
+}
+
+void ObjectCopier::copyObjectsTo(const std::vector<std::string>& outputPaths) const {
+    const auto merged = this->mergeObjects();
+
+    for (const auto& ipath : outputPaths) {
+        std::unique_ptr<TFile> out(TFile::Open(ipath.c_str(), "Update"));
+        if (!out) {
+            LOG(ERROR) << "Unable to open file at: " << ipath << "\n";
             throw std::invalid_argument("");
         }
-        files.emplace_back(std::move(f));
+
+        for (std::size_t iobject = 0; iobject < m_objectList.size(); ++iobject) {
+            if (!merged.at(iobject)) continue;
+            out->cd();
+            merged.at(iobject)->Write(m_objectList.at(iobject).first.c_str());
+        }
     }
+}
 
-    std::unique_ptr<TFile> out(TFile::Open(outputPath.c_str(), "Update"));
-    if (!out) {
-        LOG(ERROR) << "Unable to open file at: " << outputPath << "\n";
-        throw std::invalid_argument("");
+std::vector<std::unique_ptr<TObject> > ObjectCopier::mergeObjects() const {
+
+    // each worker streams through its own contiguous block of files
+    const std::size_t nWorkers = ROOT::IsImplicitMTEnabled() ? std::max<std::size_t>(std::min<std::size_t>(ROOT::GetThreadPoolSize(), m_fileList.size()), 1) : 1;
+    const std::size_t blockSize = (m_fileList.size() + nWorkers - 1) / nWorkers;
+
+    std::vector<std::future<std::vector<std::unique_ptr<TObject> > > > futures;
+    for (std::size_t iworker = 1; iworker < nWorkers; ++iworker) {
+        const std::size_t first = std::min(iworker * blockSize, m_fileList.size());
+        const std::size_t last = std::min(first + blockSize, m_fileList.size());
+        futures.emplace_back(std::async(std::launch::async, [this, first, last]() {
+            return this->sumObjectsFromFiles(first, last);
+        }));
     }
 
-    for (const auto& iobject : m_objectList) {
-        if (iobject.second == ObjectCopier::ObjectType::Histogram) {
-            auto finalHist = this->mergeHistos(iobject.first, files);
-            out->cd();
-            finalHist->Write(iobject.first.c_str());
+    std::vector<std::vector<std::unique_ptr<TObject> > > partialSums;
+    partialSums.emplace_back(this->sumObjectsFromFiles(0, std::min(blockSize, m_fileList.size())));
+    for (auto& ifuture : futures) {
+        partialSums.emplace_back(ifuture.get());
+    }
+
+    // pairwise merging, each level of the tree is merged in parallel
+    while (partialSums.size() > 1) {
+        const std::size_t half = (partialSums.size() + 1) / 2;
+        std::vector<std::future<void> > mergeFutures;
+        for (std::size_t i = 0; i + half < partialSums.size(); ++i) {
+            mergeFutures.emplace_back(std::async(std::launch::async, [this, &partialSums, i, half]() {
+                this->addObjects(partialSums.at(i), partialSums.at(i + half));
+            }));
         }
-        if (iobject.second == ObjectCopier::ObjectType::Efficiency) {
-            auto finalHist = this->mergeEfficiencies(iobject.first, files);
-            out->cd();
-            finalHist->Write(iobject.first.c_str());
+        for (auto& ifuture : mergeFutures) {
+            ifuture.get();
         }
+        partialSums.erase(partialSums.begin() + half, partialSums.end());
     }
+
+    return std::move(partialSums.front());
 }
 
-std::unique_ptr<TH1> ObjectCopier::mergeHistos(const std::string& name,
-                                               const std::vector<std::unique_ptr<TFile> >& files) const {
+std::vector<std::unique_ptr<TObject> > ObjectCopier::sumObjectsFromFiles(const std::size_t firstFile,
+                                                                         const std::size_t lastFile) const {
 
-    std::unique_ptr<TH1> result(nullptr);
+    std::vector<std::unique_ptr<TObject> > result(m_objectList.size());
 
-    for (const auto& ifile : files) {
-        std::unique_ptr<TH1> hist(ifile->Get<TH1>(name.c_str()));
-        if (!hist) {
-            LOG(ERROR) << "Cannot read histogram: " << name << "\n";
+    for (std::size_t ifile = firstFile; ifile < lastFile; ++ifile) {
+        const std::string& path = m_fileList.at(ifile);
+        std::unique_ptr<TFile> in(TFile::Open(path.c_str(), "READ"));
+        if (!in) {
+            LOG(ERROR) << "Cannot open file at: " << path << "\n";
             throw std::invalid_argument("");
         }
-        hist->SetDirectory(nullptr);
 
-        if (result) {
-            result->Add(hist.get());
-        } else {
-            result = std::move(hist);
+        std::vector<std::unique_ptr<TObject> > objects(m_objectList.size());
+        for (std::size_t iobject = 0; iobject < m_objectList.size(); ++iobject) {
+            const auto& [name, type] = m_objectList.at(iobject);
+            if (type == ObjectCopier::ObjectType::Histogram) {
+                std::unique_ptr<TH1> hist(in->Get<TH1>(name.c_str()));
+                if (!hist) {
+                    LOG(ERROR) << "Cannot read histogram: " << name << " from: " << path << "\n";
+                    throw std::invalid_argument("");
+                }
+                hist->SetDirectory(nullptr);
+                objects.at(iobject) = std::move(hist);
+            }
+            if (type == ObjectCopier::ObjectType::Efficiency) {
+                std::unique_ptr<TEfficiency> eff(in->Get<TEfficiency>(name.c_str()));
+                if (!eff) {
+                    LOG(ERROR) << "Cannot read TEfficiency: " << name << " from: " << path << "\n";
+                    throw std::invalid_argument("");
+                }
+                eff->SetDirectory(nullptr);
+                objects.at(iobject) = std::move(eff);
+            }
         }
+
+        this->addObjects(result, objects);
     }
 
     return result;
 }
 
-std::unique_ptr<TEfficiency> ObjectCopier::mergeEfficiencies(const std::string& name,
-                                                             const std::vector<std::unique_ptr<TFile> >& files) const {
-
-    std::unique_ptr<TEfficiency> result(nullptr);
+void ObjectCopier::addObjects(std::vector<std::unique_ptr<TObject> >& target,
+                              std::vector<std::unique_ptr<TObject> >& other) const {
 
-    for (const auto& ifile : files) {
-        std::unique_ptr<TEfficiency> hist(ifile->Get<TEfficiency>(name.c_str()));
-        if (!hist) {
-            LOG(ERROR) << "Cannot read TEfficiency: " << name << "\n";
-            throw std::invalid_argument("");
+    for (std::size_t iobject = 0; iobject < m_objectList.size(); ++iobject) {
+        auto& otherObject = other.at(iobject);
+        if (!otherObject) continue;
+        auto& targetObject = target.at(iobject);
+        if (!targetObject) {
+            targetObject = std::move(otherObject);
+            continue;
         }
-        hist->SetDirectory(nullptr);
 
-        if (result) {
-            *result += *hist;
+        if (m_objectList.at(iobject).second == ObjectCopier::ObjectType::Histogram) {
+            static_cast<TH1*>(targetObject.get())->Add(static_cast<const TH1*>(otherObject.get()));
         } else {
-            result = std::move(hist);
+            *static_cast<TEfficiency*>(targetObject.get()) += *static_cast<const TEfficiency*>(otherObject.get());
         }
+        otherObject.reset();
     }
-
-    return result;
 }
 
-void ObjectCopier::copyTreesTo(const std::string& outputPath,
+void ObjectCopier::copyTreesTo(const std::vector<std::string>& outputPaths,
                                const std::vector<std::string>& trees,
-                               const bool convertVecToRVec) const {
+                               const bool convertVecToRVec,
+                               const std::string& format) const {
 
     // Use RDF to merge trees and store them
     for (const auto& iobject : m_objectList) {
@@ -144,12 +196,22 @@ void ObjectCopier::copyTreesTo(const std::string& outputPath,
         auto itr = std::find(trees.begin(), trees.end(), name);
         if (itr == trees.end()) continue;
 
-        LOG(INFO) << "Started copying tree: " << name << " to " << outputPath << "\n";
+        LOG(INFO) << "Started copying tree: " << name << " to " << outputPaths.size() << " output file(s)\n";
         ROOT::RDF::RSnapshotOptions opts;
         opts.fMode = "UPDATE";
         opts.fVector2RVec = convertVecToRVec;
+        opts.fLazy = true;
+        Utils::setSnapshotFormat(opts, format);
         ROOT::RDataFrame df(name, m_fileList);
-        df.Snapshot(name, outputPath, df.GetColumnNames(), opts);
-        LOG(INFO) << "Finished copying tree: " << name << " to " << outputPath << "\n";
+        const std::vector<std::string> columns = df.GetColumnNames();
+        std::vector<ROOT::RDF::RResultPtr<ROOT::RDF::RInterface<ROOT::Detail::RDF::RLoopManager> > > snapshots;
+        for (const auto& ipath : outputPaths) {
+            snapshots.emplace_back(df.Snapshot(name, ipath, columns, opts));
+        }
+        // one event loop writes all the outputs
+        for (auto& isnapshot : snapshots) {
+            isnapshot.GetValue();
+        }
+        LOG(INFO) << "Finished copying tree: " << name << "\n";
     }
-}
\ No newline at end of file
+}
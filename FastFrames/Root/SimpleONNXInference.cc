@@ -7,11 +7,97 @@
 #include "FastFrames/SimpleONNXInference.h"
 #include "FastFrames/Logger.h"
 
+#include <algorithm>
+#include <array>
+#include <cstring>
+
 SimpleONNXInference::SimpleONNXInference(const std::string& name) noexcept :
 m_name(name)
 {
 }
 
+namespace {
+    std::vector<const SimpleONNXInference*>& instances() {
+        static std::vector<const SimpleONNXInference*> result;
+        return result;
+    }
+
+    bool isSame(const ROOT::VecOps::RVec<float>& first, const ROOT::VecOps::RVec<float>& second) {
+        return first.size() == second.size() &&
+               std::memcmp(first.data(), second.data(), first.size()*sizeof(float)) == 0;
+    }
+}
+
+std::size_t SimpleONNXInference::registerInstance(const SimpleONNXInference* instance) {
+    std::vector<const SimpleONNXInference*>& registered = instances();
+    auto itr = std::find(registered.begin(), registered.end(), instance);
+    if (itr != registered.end()) return std::distance(registered.begin(), itr);
+
+    registered.emplace_back(instance);
+    return registered.size() - 1;
+}
+
+void SimpleONNXInference::clearRegisteredInstances() {
+    instances().clear();
+}
+
+const SimpleONNXInference* SimpleONNXInference::registeredInstance(const std::size_t index) {
+    return instances().at(index);
+}
+
+void SimpleONNXInference::initializeModels(const unsigned nSlots) {
+    m_slotBuffers.resize(std::max(nSlots, 1u));
+#ifdef ONNXRUNTIME_AVAILABLE
+    GraphOptimizationLevel level = GraphOptimizationLevel::ORT_ENABLE_EXTENDED;
+    if (m_graphOptimizationLevel == "disable") {
+        level = GraphOptimizationLevel::ORT_DISABLE_ALL;
+    } else if (m_graphOptimizationLevel == "basic") {
+        level = GraphOptimizationLevel::ORT_ENABLE_BASIC;
+    } else if (m_graphOptimizationLevel == "extended") {
+        level = GraphOptimizationLevel::ORT_ENABLE_EXTENDED;
+    } else if (m_graphOptimizationLevel == "all") {
+        level = GraphOptimizationLevel::ORT_ENABLE_ALL;
+    } else {
+        LOG(ERROR) << "Unknown graph optimisation level: " << m_graphOptimizationLevel << " for model: " << m_name << "\n";
+        throw std::invalid_argument("");
+    }
+
+    m_onnx = std::make_unique<ONNXWrapper>(m_name, m_modelPaths, nSlots, m_intraOpThreads, m_interOpThreads, level, m_optimizedModelDirectory);
+#else
+    LOG(WARNING) << "You are trying to use ONNX wrapper, but the onnxruntime is not available. Please rerun cmake and recompile with onnxruntime.\n";
+#endif
+}
+
+ROOT::VecOps::RVec<float> SimpleONNXInference::runVariationInference(const unsigned int slot,
+                                                                     const unsigned long long eventNumber,
+                                                                     const ROOT::VecOps::RVec<float>& nominalResult,
+                                                                     const ROOT::VecOps::RVec<float>* const* inputs,
+                                                                     const std::size_t nInputs) const {
+    const std::size_t nLayers = nInputs/2;
+
+    // the variation does not change the inputs in this event, reuse the nominal outputs
+    bool same(true);
+    for (std::size_t ilayer = 0; ilayer < nLayers; ++ilayer) {
+        if (!isSame(*inputs[ilayer], *inputs[nLayers + ilayer])) {
+            same = false;
+            break;
+        }
+    }
+    if (same) return ROOT::VecOps::RVec<float>(nominalResult.begin(), nominalResult.end());
+
+    // copy the outputs, the batch result is a view of the slot buffer that the other variations overwrite
+    const ROOT::VecOps::RVec<float> result = this->runBatchInference(slot, eventNumber, inputs + nLayers, nLayers);
+    return ROOT::VecOps::RVec<float>(result.begin(), result.end());
+}
+
+std::size_t SimpleONNXInference::nOutputValues() const {
+    std::size_t result(0);
+    for (const auto& output : m_outputs) {
+        result += output.second.size();
+    }
+    return result;
+}
+
 
 #ifdef ONNXRUNTIME_AVAILABLE
     std::vector<float> SimpleONNXInference::runInference(const std::string& outputLayer, const unsigned long long& eventNumber, const std::map<std::string, std::vector<float>>& inputs)    const {
@@ -34,6 +120,109 @@ m_name(name)
         }
         return results;
     }
+
+    bool SimpleONNXInference::hasDynamicBatch() const {
+        return m_onnx == nullptr || m_onnx->hasDynamicBatch();
+    }
+
+    ROOT::VecOps::RVec<float> SimpleONNXInference::runBatchInference(const unsigned int slot,
+                                                                     const unsigned long long eventNumber,
+                                                                     const ROOT::VecOps::RVec<float>* const* inputs,
+                                                                     const std::size_t nInputs) const {
+        if (m_onnx == nullptr) {
+            throw std::runtime_error("ONNX model not loaded");
+        }
+
+        // the buffers of the slot are reused for every event, no allocation once they reached the needed size
+        SlotBuffers& buffers = m_slotBuffers.at(slot);
+
+        const std::size_t nLayers = m_inputs.size();
+        const std::size_t nEntries = nInputs/nLayers;
+
+        // variations that do not change the inputs (bit-identical) are evaluated only once
+        buffers.uniqueIndices.resize(nEntries);
+        buffers.uniqueInputs.clear();
+        for (std::size_t ientry = 0; ientry < nEntries; ++ientry) {
+            const ROOT::VecOps::RVec<float>* const* current = inputs + ientry*nLayers;
+            std::size_t unique(0);
+            for (; unique < buffers.uniqueInputs.size()/nLayers; ++unique) {
+                bool same(true);
+                for (std::size_t ilayer = 0; ilayer < nLayers; ++ilayer) {
+                    if (!isSame(*buffers.uniqueInputs.at(unique*nLayers + ilayer), *current[ilayer])) {
+                        same = false;
+                        break;
+                    }
+                }
+                if (same) break;
+            }
+            buffers.uniqueIndices.at(ientry) = unique;
+            if (unique == buffers.uniqueInputs.size()/nLayers) {
+                buffers.uniqueInputs.insert(buffers.uniqueInputs.end(), current, current + nLayers);
+            }
+        }
+        const std::size_t nUnique = buffers.uniqueInputs.size()/nLayers;
+
+        const std::size_t nValues = this->nOutputValues();
+        buffers.uniqueResults.resize(nUnique*nValues);
+
+        // models with a fixed batch size are evaluated one input at a time
+        const std::size_t batchSize = m_onnx->hasDynamicBatch() ? nUnique : 1;
+        const unsigned int fold = m_onnx->getSessionIndex(eventNumber);
+
+        buffers.layerValues.resize(m_inputs.size());
+        for (std::size_t start = 0; start < nUnique; start += batchSize) {
+            ONNXWrapper::Inference infer = m_onnx->createInferenceInstance();
+
+            // write the values of each input layer for all batch entries into the buffer, the tensor is a view of the buffer
+            std::size_t layerIndex(0);
+            for (const auto& input : m_inputs) {
+                const std::size_t nVars = buffers.uniqueInputs.at(layerIndex)->size();
+                std::vector<float>& values = buffers.layerValues.at(layerIndex);
+                values.resize(batchSize*nVars);
+                for (std::size_t ientry = 0; ientry < batchSize; ++ientry) {
+                    const ROOT::VecOps::RVec<float>& packed = *buffers.uniqueInputs.at((start + ientry)*nLayers + layerIndex);
+                    if (packed.size() != nVars) {
+                        LOG(ERROR) << "Inconsistent number of inputs for layer: " << input.first << " of model: " << m_name << "\n";
+                        throw std::runtime_error("");
+                    }
+                    std::copy(packed.begin(), packed.end(), values.begin() + ientry*nVars);
+                }
+                const std::array<int64_t, 2> shape{static_cast<int64_t>(batchSize), static_cast<int64_t>(nVars)};
+                infer.setInputs(input.first, values.data(), values.size(), shape.data(), shape.size());
+                ++layerIndex;
+            }
+
+            // one evaluation provides all the output layers
+            m_onnx->evaluate(infer, fold, slot);
+
+            // read the outputs directly from the output tensors, for each batch entry the output layers are concatenated
+            std::size_t layerOffset(0);
+            for (const auto& output : m_outputs) {
+                const std::size_t nOutputs = output.second.size();
+                const float* values = infer.getOutputs<float>(output.first);
+                for (std::size_t ientry = 0; ientry < batchSize; ++ientry) {
+                    std::copy(values + ientry*nOutputs, values + (ientry + 1)*nOutputs,
+                              buffers.uniqueResults.begin() + (start + ientry)*nValues + layerOffset);
+                }
+                layerOffset += nOutputs;
+            }
+        }
+
+        // the result is a view of the slot buffer, valid until the next evaluation in the same slot
+        if (nUnique == nEntries) {
+            return ROOT::VecOps::RVec<float>(buffers.uniqueResults.data(), buffers.uniqueResults.size());
+        }
+
+        // copy the outputs to the duplicated inputs
+        buffers.results.resize(nEntries*nValues);
+        for (std::size_t i = 0; i < nEntries; ++i) {
+            const std::size_t unique = buffers.uniqueIndices.at(i);
+            std::copy(buffers.uniqueResults.begin() + unique*nValues, buffers.uniqueResults.begin() + (unique + 1)*nValues,
+                      buffers.results.begin() + i*nValues);
+        }
+
+        return ROOT::VecOps::RVec<float>(buffers.results.data(), buffers.results.size());
+    }
 #else
     std::vector<float> SimpleONNXInference::runInference(const std::string& outputLayer, [[maybe_unused]] const unsigned long long& eventNumber, [[maybe_unused]] const std::map<std::string, std::vector<float>>& inputs)    const {
         std::vector<float> results;
@@ -42,5 +231,16 @@ m_name(name)
         }
         return results;
     }
+
+    bool SimpleONNXInference::hasDynamicBatch() const {
+        return true;
+    }
+
+    ROOT::VecOps::RVec<float> SimpleONNXInference::runBatchInference([[maybe_unused]] const unsigned int slot,
+                                                                     [[maybe_unused]] const unsigned long long eventNumber,
+                                                                     [[maybe_unused]] const ROOT::VecOps::RVec<float>* const* inputs,
+                                                                     const std::size_t nInputs) const {
+        return ROOT::VecOps::RVec<float>(nInputs/m_inputs.size()*this->nOutputValues(), 0);
+    }
 #endif
 
@@ -0,0 +1,327 @@
+/**
+ * @file SortedTreeIndex.cc
+ * @brief Index of a tree based on a sorted array of keys, used for matching reco and truth trees
+ *
+ */
+
+#include "FastFrames/SortedTreeIndex.h"
+
+#include "FastFrames/Logger.h"
+
+#include "TBranch.h"
+#include "TFile.h"
+#include "TLeaf.h"
+#include "TROOT.h"
+#include "TTree.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <future>
+#include <iterator>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+  /**
+   * @brief Header of the cache file, followed by the sorted keys
+   *
+   */
+  struct CacheHeader {
+    char magic[8];
+    char uuid[40];
+    Long64_t nKeys;
+  };
+
+  constexpr char cacheMagic[8] = {'F', 'F', 'I', 'N', 'D', 'E', 'X', '1'};
+}
+
+SortedTreeIndex::SortedTreeIndex(TTree* tree,
+                                 const std::string& treeName,
+                                 const std::vector<std::string>& files,
+                                 const std::string& majorName,
+                                 const std::string& minorName,
+                                 const bool useCache) :
+m_majorName(majorName),
+m_minorName(minorName)
+{
+    fTree = tree;
+    SetNameTitle(majorName.c_str(), minorName.c_str());
+
+    // the files are read in parallel only when ROOT is thread-safe
+    std::vector<std::vector<Key> > fileKeys(files.size());
+    const std::size_t nWorkers = ROOT::IsImplicitMTEnabled() ? std::min<std::size_t>(ROOT::GetThreadPoolSize(), files.size()) : 1;
+    std::atomic<std::size_t> nextFile(0);
+    auto worker = [&]() {
+        for (std::size_t ifile = nextFile++; ifile < files.size(); ifile = nextFile++) {
+            fileKeys.at(ifile) = SortedTreeIndex::keysFromFile(files.at(ifile), treeName, majorName, minorName, useCache);
+        }
+    };
+
+    std::vector<std::future<void> > futures;
+    for (std::size_t iworker = 1; iworker < nWorkers; ++iworker) {
+        futures.emplace_back(std::async(std::launch::async, worker));
+    }
+    worker();
+    for (auto& ifuture : futures) {
+        ifuture.get();
+    }
+
+    // the chain numbers the entries of the files consecutively
+    auto keys = std::make_shared<std::vector<Key> >();
+    std::size_t total(0);
+    for (const auto& ikeys : fileKeys) {
+        total += ikeys.size();
+    }
+    keys->reserve(total);
+    std::vector<std::size_t> boundaries{0};
+    for (auto& ikeys : fileKeys) {
+        const Long64_t offset = keys->size();
+        for (const auto& ikey : ikeys) {
+            keys->push_back({ikey.major, ikey.minor, ikey.entry + offset});
+        }
+        boundaries.emplace_back(keys->size());
+        std::vector<Key>().swap(ikeys);
+    }
+
+    // merge the sorted files pairwise
+    while (boundaries.size() > 2) {
+        std::vector<std::size_t> merged{0};
+        for (std::size_t i = 2; i < boundaries.size(); i += 2) {
+            std::inplace_merge(keys->begin() + boundaries.at(i - 2), keys->begin() + boundaries.at(i - 1), keys->begin() + boundaries.at(i));
+            merged.emplace_back(boundaries.at(i));
+        }
+        if (boundaries.size() % 2 == 0) merged.emplace_back(boundaries.back());
+        boundaries = std::move(merged);
+    }
+
+    m_keys = std::move(keys);
+}
+
+SortedTreeIndex::SortedTreeIndex(const SortedTreeIndex& other) :
+TVirtualIndex(),
+m_majorName(other.m_majorName),
+m_minorName(other.m_minorName),
+m_keys(other.m_keys)
+{
+    fTree = nullptr;
+    SetNameTitle(other.GetName(), other.GetTitle());
+}
+
+SortedTreeIndex::~SortedTreeIndex() {
+    if (fTree && fTree->GetTreeIndex() == this) fTree->SetTreeIndex(nullptr);
+}
+
+std::vector<SortedTreeIndex::Key> SortedTreeIndex::keysFromFile(const std::string& path,
+                                                                const std::string& treeName,
+                                                                const std::string& majorName,
+                                                                const std::string& minorName,
+                                                                const bool useCache) {
+
+    std::unique_ptr<TFile> file(TFile::Open(path.c_str(), "READ"));
+    if (!file) {
+        LOG(ERROR) << "Cannot open ROOT file at: " << path << "\n";
+        throw std::invalid_argument("");
+    }
+
+    TTree* tree = file->Get<TTree>(treeName.c_str());
+    if (!tree) {
+        LOG(ERROR) << "Cannot read TTree: " << treeName << " from: " << path << "\n";
+        throw std::invalid_argument("");
+    }
+
+    TLeaf* major = tree->GetLeaf(majorName.c_str());
+    TLeaf* minor = minorName == "0" ? nullptr : tree->GetLeaf(minorName.c_str());
+    if (!major || (minorName != "0" && !minor)) {
+        LOG(ERROR) << "Cannot read the index branches: " << majorName << ", " << minorName << " from TTree: " << treeName << "\n";
+        throw std::invalid_argument("");
+    }
+
+    const Long64_t nEntries = tree->GetEntries();
+    const std::string cache = useCache ? SortedTreeIndex::cachePath(path, treeName, majorName, minorName) : "";
+    const std::string uuid = file->GetUUID().AsString();
+    std::vector<Key> result;
+    if (!cache.empty() && SortedTreeIndex::readCache(cache, uuid, nEntries, &result)) {
+        return result;
+    }
+
+    // only the index branches are read, sequentially
+    result.reserve(nEntries);
+    for (Long64_t ientry = 0; ientry < nEntries; ++ientry) {
+        result.push_back({SortedTreeIndex::leafValue(major, ientry),
+                          minor ? SortedTreeIndex::leafValue(minor, ientry) : 0,
+                          ientry});
+    }
+    std::sort(result.begin(), result.end());
+
+    if (!cache.empty()) {
+        SortedTreeIndex::writeCache(cache, uuid, result);
+    }
+
+    return result;
+}
+
+std::string SortedTreeIndex::cachePath(const std::string& path,
+                                       const std::string& treeName,
+                                       const std::string& majorName,
+                                       const std::string& minorName) {
+
+    // only local files are cached
+    std::string local = path;
+    if (local.rfind("file://", 0) == 0) {
+        local = local.substr(7);
+    } else if (local.find("://") != std::string::npos) {
+        return "";
+    }
+
+    std::string result = local + "." + treeName + "." + majorName;
+    if (minorName != "0") result += "_" + minorName;
+
+    return result + ".ffindex";
+}
+
+bool SortedTreeIndex::readCache(const std::string& cachePath,
+                                const std::string& uuid,
+                                const Long64_t nEntries,
+                                std::vector<Key>* keys) {
+
+    const int fd = ::open(cachePath.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat info;
+    if (::fstat(fd, &info) != 0 || static_cast<std::size_t>(info.st_size) < sizeof(CacheHeader)) {
+        ::close(fd);
+        return false;
+    }
+
+    const std::size_t size = info.st_size;
+    void* data = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (data == MAP_FAILED) return false;
+
+    CacheHeader header;
+    std::memcpy(&header, data, sizeof(CacheHeader));
+    const bool isValid = std::memcmp(header.magic, cacheMagic, sizeof(cacheMagic)) == 0 &&
+                         uuid == std::string(header.uuid, ::strnlen(header.uuid, sizeof(header.uuid))) &&
+                         header.nKeys == nEntries &&
+                         size == sizeof(CacheHeader) + header.nKeys * sizeof(Key);
+
+    if (isValid) {
+        const Key* begin = reinterpret_cast<const Key*>(static_cast<const char*>(data) + sizeof(CacheHeader));
+        keys->assign(begin, begin + header.nKeys);
+    } else {
+        LOG(DEBUG) << "The reco-truth index cache: " << cachePath << " does not match the input, rebuilding it\n";
+    }
+    ::munmap(data, size);
+
+    return isValid;
+}
+
+void SortedTreeIndex::writeCache(const std::string& cachePath,
+                                 const std::string& uuid,
+                                 const std::vector<Key>& keys) {
+
+    CacheHeader header{};
+    std::memcpy(header.magic, cacheMagic, sizeof(cacheMagic));
+    std::strncpy(header.uuid, uuid.c_str(), sizeof(header.uuid) - 1);
+    header.nKeys = keys.size();
+
+    // written to a temporary file first so that other jobs never read a partial cache
+    const std::string tmpPath = cachePath + ".tmp" + std::to_string(::getpid());
+    {
+        std::ofstream out(tmpPath, std::ios::binary);
+        if (!out.good()) {
+            LOG(DEBUG) << "Cannot write the reco-truth index cache: " << cachePath << "\n";
+            return;
+        }
+        out.write(reinterpret_cast<const char*>(&header), sizeof(CacheHeader));
+        out.write(reinterpret_cast<const char*>(keys.data()), keys.size() * sizeof(Key));
+        if (!out.good()) {
+            out.close();
+            std::remove(tmpPath.c_str());
+            LOG(DEBUG) << "Cannot write the reco-truth index cache: " << cachePath << "\n";
+            return;
+        }
+    }
+
+    if (std::rename(tmpPath.c_str(), cachePath.c_str()) != 0) {
+        std::remove(tmpPath.c_str());
+    }
+}
+
+void SortedTreeIndex::Append(const TVirtualIndex*, bool) {
+    LOG(ERROR) << "SortedTreeIndex cannot be appended, it is built for the whole chain\n";
+    throw std::runtime_error("");
+}
+
+Long64_t SortedTreeIndex::GetEntryNumberFriend(const TTree* parent) {
+    if (!parent) return -3;
+
+    // the values are read from the tree currently loaded by the parent (chain)
+    const TTree* current = parent->GetTree();
+    if (!current) return -1;
+    const Long64_t entry = current->GetReadEntry();
+    if (entry < 0 || entry >= current->GetEntries()) return -2;
+
+    if (current != m_parentTree) {
+        m_parentTree = current;
+        m_parentMajor = const_cast<TTree*>(current)->GetLeaf(m_majorName.c_str());
+        m_parentMinor = m_minorName == "0" ? nullptr : const_cast<TTree*>(current)->GetLeaf(m_minorName.c_str());
+    }
+    if (!m_parentMajor || (m_minorName != "0" && !m_parentMinor)) return -1;
+
+    return this->GetEntryNumberWithIndex(SortedTreeIndex::leafValue(m_parentMajor, entry),
+                                         m_parentMinor ? SortedTreeIndex::leafValue(m_parentMinor, entry) : 0);
+}
+
+Long64_t SortedTreeIndex::GetEntryNumberWithIndex(Long64_t major, Long64_t minor) const {
+    const Key key{major, minor, -1};
+    auto itr = std::lower_bound(m_keys->begin(), m_keys->end(), key);
+    if (itr == m_keys->end() || itr->major != major || itr->minor != minor) return -1;
+
+    return itr->entry;
+}
+
+Long64_t SortedTreeIndex::GetEntryNumberWithBestIndex(Long64_t major, Long64_t minor) const {
+    const Key key{major, minor, -1};
+    auto itr = std::lower_bound(m_keys->begin(), m_keys->end(), key);
+    if (itr != m_keys->end() && itr->major == major && itr->minor == minor) return itr->entry;
+    if (itr == m_keys->begin()) return -1;
+
+    return std::prev(itr)->entry;
+}
+
+bool SortedTreeIndex::IsValidFor(const TTree* parent) {
+    if (!parent) return false;
+    TTree* tree = const_cast<TTree*>(parent);
+    if (!tree->GetLeaf(m_majorName.c_str())) return false;
+
+    return m_minorName == "0" || tree->GetLeaf(m_minorName.c_str());
+}
+
+void SortedTreeIndex::UpdateFormulaLeaves(const TTree*) {
+    m_parentTree = nullptr;
+    m_parentMajor = nullptr;
+    m_parentMinor = nullptr;
+}
+
+void SortedTreeIndex::SetTree(TTree* tree) {
+    fTree = tree;
+    this->UpdateFormulaLeaves(nullptr);
+}
+
+TObject* SortedTreeIndex::Clone(const char*) const {
+    return new SortedTreeIndex(*this);
+}
+
+Long64_t SortedTreeIndex::leafValue(TLeaf* leaf, const Long64_t entry) {
+    leaf->GetBranch()->GetEntry(entry);
+
+    return leaf->GetValueLong64();
+}
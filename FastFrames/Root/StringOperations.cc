@@ -146,4 +146,75 @@ std::string StringOperations::joinStrings(const std::string &separator, const st
     }
     if (result.size() > 0) result.erase(result.size()-separator.size());
     return result;
-};
\ No newline at end of file
+};
+
+std::vector<std::string> StringOperations::splitConjunction(const std::string &expression)   {
+    std::string stripped = expression;
+    stripString(&stripped, " \n\t\r");
+
+    // position of the bracket closing the one at the given position, npos if not balanced
+    auto closingBracket = [&stripped](const std::size_t open) {
+        int depth = 0;
+        char quote = 0;
+        for (std::size_t i = open; i < stripped.size(); ++i) {
+            const char c = stripped.at(i);
+            if (quote) {
+                if (c == '\\') ++i;
+                else if (c == quote) quote = 0;
+                continue;
+            }
+            if (c == '"' || c == '\'') quote = c;
+            else if (c == '(' || c == '[' || c == '{') ++depth;
+            else if (c == ')' || c == ']' || c == '}') {
+                --depth;
+                if (depth == 0) return i;
+            }
+        }
+        return std::string::npos;
+    };
+
+    // remove the brackets enclosing the whole expression
+    while (!stripped.empty() && stripped.front() == '(' && closingBracket(0) == stripped.size() - 1) {
+        stripped = stripped.substr(1, stripped.size() - 2);
+        stripString(&stripped, " \n\t\r");
+    }
+    if (stripped.empty()) return {};
+
+    std::vector<std::size_t> splits;
+    int depth = 0;
+    char quote = 0;
+    for (std::size_t i = 0; i < stripped.size(); ++i) {
+        const char c = stripped.at(i);
+        if (quote) {
+            if (c == '\\') ++i;
+            else if (c == quote) quote = 0;
+            continue;
+        }
+        if (c == '"' || c == '\'') quote = c;
+        else if (c == '(' || c == '[' || c == '{') ++depth;
+        else if (c == ')' || c == ']' || c == '}') --depth;
+        else if (depth == 0) {
+            const bool isDouble = i + 1 < stripped.size() && stripped.at(i + 1) == c;
+            if ((c == '|' && isDouble) || c == '?' || c == ',' || c == ';') return {stripped};
+            if (c == '&' && isDouble) {
+                splits.emplace_back(i);
+                ++i;
+            }
+        }
+        if (depth < 0) return {stripped};
+    }
+    if (depth != 0 || quote) return {stripped};
+    if (splits.empty()) return {stripped};
+
+    std::vector<std::string> result;
+    std::size_t begin = 0;
+    splits.emplace_back(stripped.size());
+    for (const std::size_t end : splits) {
+        const std::vector<std::string> terms = StringOperations::splitConjunction(stripped.substr(begin, end - begin));
+        if (terms.empty()) return {stripped};
+        result.insert(result.end(), terms.begin(), terms.end());
+        begin = end + 2;
+    }
+
+    return result;
+}
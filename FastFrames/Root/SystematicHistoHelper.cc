@@ -0,0 +1,71 @@
+/**
+ * @file SystematicHistoHelper.cc
+ * @brief Custom RDataFrame action filling histograms for many systematic variations at once
+ *
+ */
+
+#include "FastFrames/SystematicHistoHelper.h"
+
+#include "FastFrames/Logger.h"
+
+#include <exception>
+
+SystematicHisto1DHelper::SystematicHisto1DHelper(const ROOT::RDF::TH1DModel& model,
+                                                 const std::size_t nHistos,
+                                                 const unsigned int nSlots) :
+m_result(std::make_shared<Result_t>()),
+m_perSlotHistos(nSlots)
+{
+    const std::shared_ptr<TH1D> modelHisto = model.GetHistogram();
+    modelHisto->SetDirectory(nullptr);
+    modelHisto->Sumw2();
+
+    for (auto& islot : m_perSlotHistos) {
+        islot.reserve(nHistos);
+        for (std::size_t ihist = 0; ihist < nHistos; ++ihist) {
+            islot.emplace_back(*modelHisto);
+            islot.back().SetDirectory(nullptr);
+        }
+    }
+}
+
+void SystematicHisto1DHelper::Exec(unsigned int slot,
+                                   const ROOT::VecOps::RVec<double>& values,
+                                   const ROOT::VecOps::RVec<double>& weights,
+                                   const ROOT::VecOps::RVec<bool>& passed) {
+
+    std::vector<TH1D>& histos = m_perSlotHistos[slot];
+    const std::size_t size = histos.size();
+    for (std::size_t ihist = 0; ihist < size; ++ihist) {
+        if (!passed[ihist]) continue;
+        histos[ihist].Fill(values[ihist], weights[ihist]);
+    }
+}
+
+void SystematicHisto1DHelper::Exec(unsigned int slot,
+                                   const double value,
+                                   const ROOT::VecOps::RVec<double>& weights) {
+
+    std::vector<TH1D>& histos = m_perSlotHistos[slot];
+    const std::size_t size = histos.size();
+    for (std::size_t ihist = 0; ihist < size; ++ihist) {
+        histos[ihist].Fill(value, weights[ihist]);
+    }
+}
+
+void SystematicHisto1DHelper::Finalize() {
+    if (m_perSlotHistos.empty()) {
+        LOG(ERROR) << "No processing slots available for the systematic histograms\n";
+        throw std::runtime_error("");
+    }
+
+    std::vector<TH1D>& result = m_perSlotHistos.front();
+    for (std::size_t islot = 1; islot < m_perSlotHistos.size(); ++islot) {
+        for (std::size_t ihist = 0; ihist < result.size(); ++ihist) {
+            result.at(ihist).Add(&m_perSlotHistos.at(islot).at(ihist));
+        }
+    }
+
+    *m_result = std::move(result);
+    m_perSlotHistos.clear();
+}
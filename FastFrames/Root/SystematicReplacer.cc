@@ -9,11 +9,13 @@
 #include "FastFrames/Logger.h"
 #include "FastFrames/Systematic.h"
 #include "FastFrames/StringOperations.h"
+#include "FastFrames/Utils.h"
 
 #include "TFile.h"
 #include "TTree.h"
 
 #include <algorithm>
+#include <cctype>
 #include <exception>
 
 SystematicReplacer::SystematicReplacer() noexcept
@@ -26,6 +28,8 @@ void SystematicReplacer::readSystematicMapFromFile(const std::string& path,
     m_systImpactsBranches.clear();
     m_branchesAffectedBySyst.clear();
     m_allBranches.clear();
+    m_allBranchesSet.clear();
+    m_replacedFormulas.clear();
     std::unique_ptr<TFile> file(TFile::Open(path.c_str(), "read"));
     if (!file) {
         LOG(ERROR) << "Cannot open ROOT file at: " << path << "\n";
@@ -41,6 +45,15 @@ void SystematicReplacer::readSystematicMapFromFile(const std::string& path,
 void SystematicReplacer::getBranchesFromFile(const std::unique_ptr<TFile>& file,
                                              const std::string& treeName) {
 
+    // the fields of an RNTuple are read as the columns of RDataFrame
+    if (Utils::isRNTuple(treeName, {file->GetName()})) {
+        ROOT::RDataFrame df = Utils::dataFrameFromFiles(treeName, {file->GetName()}, nullptr);
+        for (const auto& icolumn : df.GetColumnNames()) {
+            this->addBranch(icolumn);
+        }
+        return;
+    }
+
     TTree* tree = file->Get<TTree>(treeName.c_str());
     if (!tree) {
         LOG(ERROR) << "Cannot read TTree: " << treeName << "\n";
@@ -51,7 +64,7 @@ void SystematicReplacer::getBranchesFromFile(const std::unique_ptr<TFile>& file,
     std::size_t branchSize = tree->GetNbranches();
     for (std::size_t ibranch = 0; ibranch < branchSize; ++ibranch) {
         const std::string name = branchList->At(ibranch)->GetName();
-        m_allBranches.emplace_back(std::move(name));
+        this->addBranch(name);
     }
 }
 
@@ -71,6 +84,7 @@ void SystematicReplacer::matchSystematicVariables(const std::vector<std::string>
         }
 
         m_systImpactsBranches.insert({systName, affectedBranches});
+        this->invalidateCache(systName);
     }
 
     // now do it the other way around
@@ -97,17 +111,96 @@ std::string SystematicReplacer::replaceString(const std::string& original, const
         throw std::invalid_argument("");
     }
 
-    std::string result(original);
+    std::unordered_map<std::string, std::string>& cache = m_replacedFormulas[systematicName];
+    auto itrCache = cache.find(original);
+    if (itrCache != cache.end()) return itrCache->second;
+
+    std::string result;
+    result.reserve(original.size());
 
-    // loop over all affected branches and replace all of them
-    for (const std::string& ibranch : itr->second) {
-        const std::string replacer = StringOperations::replaceString(ibranch, "NOSYS", systematicName);
-        result = StringOperations::replaceString(result, ibranch, replacer);
+    // single pass over the identifiers, only the ones affected by the systematic are replaced
+    for (const auto& itoken : this->tokenise(original)) {
+        if (itoken.second) {
+            result += this->replaceToken(itoken.first, systematicName);
+        } else {
+            result += itoken.first;
+        }
     }
 
+    cache.emplace(original, result);
+
     return result;
 }
 
+const std::vector<std::pair<std::string, bool> >& SystematicReplacer::tokenise(const std::string& formula) const {
+    auto itr = m_tokenisedFormulas.find(formula);
+    if (itr != m_tokenisedFormulas.end()) return itr->second;
+
+    auto isIdentifierChar = [](const char c) {
+        return std::isalnum(static_cast<unsigned char>(c)) || c == '_' || c == '.';
+    };
+
+    std::vector<std::pair<std::string, bool> > result;
+    std::size_t position(0);
+    while (position < formula.size()) {
+        const std::size_t start = position;
+        const bool isIdentifier = isIdentifierChar(formula.at(position));
+        while (position < formula.size() && isIdentifierChar(formula.at(position)) == isIdentifier) {
+            ++position;
+        }
+        const std::string part = formula.substr(start, position - start);
+        const bool canReplace = isIdentifier && part.find("NOSYS") != std::string::npos;
+
+        // merge the consecutive parts that cannot be replaced
+        if (!canReplace && !result.empty() && !result.back().second) {
+            result.back().first += part;
+        } else {
+            result.emplace_back(part, canReplace);
+        }
+    }
+
+    return m_tokenisedFormulas.emplace(formula, std::move(result)).first->second;
+}
+
+std::string SystematicReplacer::replaceToken(const std::string& token, const std::string& systematicName) const {
+    if (this->isAffected(token, systematicName)) {
+        return StringOperations::replaceString(token, "NOSYS", systematicName);
+    }
+
+    if (token.find('.') == std::string::npos) return token;
+
+    // e.g. object.member_NOSYS, check the parts separately
+    std::string result;
+    std::size_t start(0);
+    while (true) {
+        const std::size_t end = token.find('.', start);
+        const std::string part = token.substr(start, end == std::string::npos ? std::string::npos : end - start);
+        result += this->isAffected(part, systematicName) ? StringOperations::replaceString(part, "NOSYS", systematicName) : part;
+        if (end == std::string::npos) break;
+        result += ".";
+        start = end + 1;
+    }
+
+    return result;
+}
+
+bool SystematicReplacer::isAffected(const std::string& branch, const std::string& systematicName) const {
+    auto itr = m_branchesAffectedBySyst.find(branch);
+    if (itr == m_branchesAffectedBySyst.end()) return false;
+
+    return std::find(itr->second.begin(), itr->second.end(), systematicName) != itr->second.end();
+}
+
+void SystematicReplacer::invalidateCache(const std::string& systematicName) {
+    m_replacedFormulas.erase(systematicName);
+}
+
+void SystematicReplacer::addBranch(const std::string& name) {
+    if (m_allBranchesSet.insert(name).second) {
+        m_allBranches.emplace_back(name);
+    }
+}
+
 std::vector<std::string> SystematicReplacer::replaceVector(const std::vector<std::string>& originalVector, const std::string& systematicName) const {
     std::vector<std::string> result;
     for (const auto& ielement : originalVector) {
@@ -118,9 +211,7 @@ std::vector<std::string> SystematicReplacer::replaceVector(const std::vector<std
 }
 
 bool SystematicReplacer::branchExists(const std::string& name) const {
-    auto itr = std::find(m_allBranches.begin(), m_allBranches.end(), name);
-
-    return itr != m_allBranches.end();
+    return m_allBranchesSet.find(name) != m_allBranchesSet.end();
 }
 
 std::vector<std::string> SystematicReplacer::getListOfEffectiveSystematics(const std::vector<std::string>& columns) const {
@@ -161,7 +252,7 @@ void SystematicReplacer::addVariableAndEffectiveSystematics(const std::string& v
     }
 
     // add to the list of branches
-    m_allBranches.emplace_back(variable);
+    this->addBranch(variable);
 
     // add to the maps of systematics
     m_branchesAffectedBySyst.insert({variable, systematics});
@@ -173,10 +264,11 @@ void SystematicReplacer::addVariableAndEffectiveSystematics(const std::string& v
             throw std::invalid_argument("");
         }
         itr->second.emplace_back(variable);
+        this->invalidateCache(isystematic);
 
         const std::string systName = this->replaceString(variable, isystematic);
         if (systName == variable) continue;
-        m_allBranches.emplace_back(systName);
+        this->addBranch(systName);
     }
 }
 
@@ -207,8 +299,10 @@ void SystematicReplacer::addSingleSystematic(const std::string& variable, const
         }
     }
 
+    this->invalidateCache(systematic);
+
     if (!this->branchExists(variable)) {
-        m_allBranches.emplace_back(variable);
+        this->addBranch(variable);
     }
 }
 
@@ -233,6 +327,7 @@ void SystematicReplacer::addTruthBranchesNominal(const std::string& truthTreeNam
         }
 
         itrSyst->second.emplace_back(branch);
+        this->invalidateCache("NOSYS");
 
         if (!isAlreadyAdded) {
             // if it is unique, add it also without the "."
@@ -270,6 +365,14 @@ void SystematicReplacer::updateVariableAndEffectiveSystematics(const std::string
         }
     }
 
+    // the replacements for the systematics that were or are now affecting the variable are no longer valid
+    for (const auto& isyst : m_branchesAffectedBySyst[variable]) {
+        this->invalidateCache(isyst);
+    }
+    for (const auto& isyst : systematics) {
+        this->invalidateCache(isyst);
+    }
+
     // overwrite old systematics list with new one
     m_branchesAffectedBySyst[variable] = systematics;
 }
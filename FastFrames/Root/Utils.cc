@@ -9,16 +9,26 @@
 #include "FastFrames/Logger.h"
 #include "FastFrames/Sample.h"
 
+#include "RVersion.h"
 #include "TChain.h"
+#include "TEntryList.h"
+#include "TFile.h"
+#include "TKey.h"
 #include "TTreeIndex.h"
 
 #include <algorithm>
 #include <exception>
+#include <mutex>
 #include <regex>
 
 std::unique_ptr<TChain> Utils::chainFromFiles(const std::string& treeName,
                                               const std::vector<std::string>& files) {
 
+    if (Utils::isRNTuple(treeName, files)) {
+        LOG(DEBUG) << "Input: " << treeName << " is an RNTuple, it cannot be read with a TChain\n";
+        return nullptr;
+    }
+
     std::unique_ptr<TChain> chain = std::make_unique<TChain>(treeName.c_str());
 
     for (const auto& ifile : files) {
@@ -28,6 +38,54 @@ std::unique_ptr<TChain> Utils::chainFromFiles(const std::string& treeName,
     return chain;
 }
 
+bool Utils::isRNTuple(const std::string& name, const std::vector<std::string>& files) {
+    if (files.empty()) return false;
+
+    std::unique_ptr<TFile> file(TFile::Open(files.at(0).c_str(), "READ"));
+    if (!file) {
+        LOG(ERROR) << "Cannot open file at: " << files.at(0) << "\n";
+        throw std::invalid_argument("");
+    }
+
+    const TKey* key = file->GetKey(name.c_str());
+    if (!key) return false;
+
+    // ROOT::RNTuple since ROOT 6.34, ROOT::Experimental::RNTuple before
+    const std::string className = key->GetClassName();
+    return className == "ROOT::RNTuple" || className == "ROOT::Experimental::RNTuple";
+}
+
+ROOT::RDataFrame Utils::dataFrameFromFiles(const std::string& name,
+                                           const std::vector<std::string>& files,
+                                           const std::unique_ptr<TChain>& chain) {
+
+    if (chain) return ROOT::RDataFrame(*chain);
+
+    #if ROOT_VERSION_CODE >= ROOT_VERSION(6,34,0)
+    // RDataFrame detects the RNTuple from the files
+    return ROOT::RDataFrame(name, files);
+    #else
+    LOG(ERROR) << "Reading RNTuple: " << name << " requires ROOT 6.34 or newer\n";
+    throw std::invalid_argument("");
+    #endif
+}
+
+void Utils::setSnapshotFormat([[maybe_unused]] ROOT::RDF::RSnapshotOptions& opts, const std::string& format) {
+    if (format == "ttree") return;
+
+    if (format != "rntuple") {
+        LOG(ERROR) << "Unknown ntuple format: " << format << ", only \"ttree\" and \"rntuple\" are supported\n";
+        throw std::invalid_argument("");
+    }
+
+    #if ROOT_VERSION_CODE >= ROOT_VERSION(6,34,0)
+    opts.fOutputFormat = ROOT::RDF::ESnapshotOutputFormat::kRNTuple;
+    #else
+    LOG(ERROR) << "Writing RNTuple requires ROOT 6.34 or newer\n";
+    throw std::invalid_argument("");
+    #endif
+}
+
 std::vector<double> fromRegularToEdges(const Variable& v){
     // We create a TH1D just as a proxy to get the bin edges
     TH1D histo("", "", v.axisNbins(), v.axisMin(), v.axisMax());
@@ -110,12 +168,144 @@ std::vector<std::string> Utils::selectedFileList(const std::vector<std::string>&
 
     std::vector<std::string> result;
     for (std::size_t i = 0; i < fileList.size(); ++i) {
-        static int totalIndex(0);
-        if ((int)totalIndex % split == index) {
+        if (static_cast<int>(i % split) == index) {
             LOG(DEBUG) << "Split N: " << split << ", index: " << index << ", adding file: " << fileList.at(i) << "\n";
             result.emplace_back(fileList.at(i));
         }
-        ++totalIndex;
+    }
+
+    return result;
+}
+
+long long Utils::entriesInFile(const std::string& path, const std::string& treeName) {
+    static std::mutex cacheMutex;
+    static std::map<std::pair<std::string, std::string>, long long> cache;
+
+    const auto key = std::make_pair(path, treeName);
+    {
+        std::lock_guard<std::mutex> lock(cacheMutex);
+        auto itr = cache.find(key);
+        if (itr != cache.end()) return itr->second;
+    }
+
+    std::unique_ptr<TFile> file(TFile::Open(path.c_str(), "READ"));
+    if (!file) {
+        LOG(ERROR) << "Cannot open ROOT file at: " << path << "\n";
+        throw std::invalid_argument("");
+    }
+    const TTree* tree = file->Get<TTree>(treeName.c_str());
+    if (!tree) {
+        LOG(ERROR) << "Cannot read TTree: " << treeName << " from: " << path << ", splitting by entries is only supported for TTree inputs\n";
+        throw std::invalid_argument("");
+    }
+    const long long result = tree->GetEntries();
+
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    cache[key] = result;
+
+    return result;
+}
+
+std::vector<Utils::FileEntryRange> Utils::selectedEntryRanges(const std::vector<std::string>& fileList,
+                                                              const std::string& treeName,
+                                                              const int split,
+                                                              const int index) {
+
+    if (index < 0 || split <= 0 || index >= split) {
+        LOG(ERROR) << "Index: " << index << " is not valid for split: " << split << ", cannot proceed\n";
+        throw std::invalid_argument("");
+    }
+
+    std::vector<long long> entries;
+    long long total(0);
+    for (const auto& ifile : fileList) {
+        entries.emplace_back(Utils::entriesInFile(ifile, treeName));
+        total += entries.back();
+    }
+
+    // the global range of this job, written to avoid the overflow of total * index
+    const long long begin = (total / split) * index + ((total % split) * index) / split;
+    const long long end   = (total / split) * (index + 1) + ((total % split) * (index + 1)) / split;
+    const bool isLastJob  = index == split - 1;
+
+    std::vector<FileEntryRange> result;
+    long long offset(0);
+    for (std::size_t i = 0; i < fileList.size(); ++i) {
+        const long long fileBegin = offset;
+        const long long fileEnd   = offset + entries.at(i);
+        offset = fileEnd;
+
+        if (entries.at(i) == 0) {
+            // empty files are assigned to the job where they start (the last job gets the ones at the end)
+            if ((fileBegin >= begin && fileBegin < end) || (isLastJob && fileBegin == total)) {
+                result.push_back({fileList.at(i), 0, 0, 0});
+            }
+            continue;
+        }
+
+        const long long first = std::max(begin, fileBegin);
+        const long long last  = std::min(end, fileEnd);
+        if (first >= last) continue;
+
+        LOG(DEBUG) << "Split N: " << split << ", index: " << index << ", adding file: " << fileList.at(i)
+                   << ", entries: [" << first - fileBegin << ", " << last - fileBegin << ")\n";
+        result.push_back({fileList.at(i), first - fileBegin, last - fileBegin, entries.at(i)});
+    }
+
+    return result;
+}
+
+std::vector<std::string> Utils::filesFromEntryRanges(const std::vector<FileEntryRange>& ranges,
+                                                     const bool onlyFromFirstEntry) {
+
+    std::vector<std::string> result;
+    for (const auto& irange : ranges) {
+        if (onlyFromFirstEntry && irange.firstEntry != 0) continue;
+        result.emplace_back(irange.path);
+    }
+
+    return result;
+}
+
+void Utils::applyEntryRanges(const std::unique_ptr<TChain>& chain,
+                             const std::string& treeName,
+                             const std::vector<FileEntryRange>& ranges) {
+
+    if (!chain) return;
+    const bool isPartial = std::any_of(ranges.begin(), ranges.end(), [](const auto& element){
+        return element.firstEntry != 0 || element.lastEntry != element.nEntries;
+    });
+    if (!isPartial) return;
+
+    // the chain deletes the list
+    TEntryList* list = new TEntryList("", "");
+    list->SetDirectory(nullptr);
+    for (const auto& irange : ranges) {
+        if (irange.firstEntry == irange.lastEntry) continue;
+        TEntryList sublist("", "", treeName.c_str(), irange.path.c_str());
+        sublist.EnterRange(irange.firstEntry, irange.lastEntry);
+        list->Add(&sublist);
+    }
+    list->SetBit(kCanDelete);
+    chain->SetEntryList(list);
+}
+
+std::vector<Utils::FileEntryRange> Utils::fullEntryRanges(const std::vector<std::string>& fileList,
+                                                          const std::string& treeName) {
+
+    std::vector<FileEntryRange> result;
+    for (const auto& ifile : fileList) {
+        const long long entries = Utils::entriesInFile(ifile, treeName);
+        result.push_back({ifile, 0, entries, entries});
+    }
+
+    return result;
+}
+
+std::string Utils::entryRangesToString(const std::vector<FileEntryRange>& ranges) {
+    std::string result;
+    for (const auto& irange : ranges) {
+        result += irange.path + " " + std::to_string(irange.firstEntry) + " " + std::to_string(irange.lastEntry) + " " + std::to_string(irange.nEntries) + "\n";
     }
 
     return result;
@@ -351,4 +541,24 @@ std::vector<std::string> Utils::getColumnsFromString(const std::string& formula,
     }
 
     return result;
-}
\ No newline at end of file
+}
+
+std::string Utils::packedColumnDefinition(const std::string& type,
+                                          const std::vector<std::string>& elements,
+                                          const std::string& flagsColumn) {
+
+    std::string result = "ROOT::VecOps::RVec<" + type + ">{";
+    for (std::size_t i = 0; i < elements.size(); ++i) {
+        if (i != 0) result += ", ";
+        const std::string element = "static_cast<" + type + ">(" + elements.at(i) + ")";
+        if (flagsColumn.empty()) {
+            result += element;
+        } else {
+            // only evaluate the expression when the corresponding flag is set
+            result += flagsColumn + "[" + std::to_string(i) + "] ? " + element + " : " + type + "()";
+        }
+    }
+    result += "}";
+
+    return result;
+}
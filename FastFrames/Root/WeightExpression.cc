@@ -0,0 +1,273 @@
+/**
+ * @file WeightExpression.cc
+ * @brief Compiled evaluation of weight formulas that are products of columns
+ *
+ */
+
+#include "FastFrames/WeightExpression.h"
+
+#include "FastFrames/Logger.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <exception>
+
+namespace {
+
+    /**
+     * @brief Define a column converted to double
+     *
+     * @tparam T Type of the original column
+     * @param node The node
+     * @param name Name of the new column
+     * @param column Name of the original column
+     * @return ROOT::RDF::RNode
+     */
+    template <typename T>
+    ROOT::RDF::RNode defineAsDouble(ROOT::RDF::RNode node, const std::string& name, const std::string& column) {
+        return node.Define(name, [](const T value){return static_cast<double>(value);}, {column});
+    }
+
+    /**
+     * @brief Is the column type supported by the compiled functor?
+     *
+     * @param type Column type as returned by RDataFrame
+     * @return true
+     * @return false
+     */
+    bool isSupportedType(const std::string& type) {
+        static const std::vector<std::string> supported = {
+            "double", "Double_t", "float", "Float_t",
+            "int", "Int_t", "unsigned int", "UInt_t",
+            "long", "Long_t", "long long", "Long64_t",
+            "unsigned long", "ULong_t", "unsigned long long", "ULong64_t",
+            "short", "Short_t", "unsigned short", "UShort_t",
+            "char", "Char_t", "unsigned char", "UChar_t",
+            "bool", "Bool_t"
+        };
+
+        return std::find(supported.begin(), supported.end(), type) != supported.end();
+    }
+
+    /**
+     * @brief Is the column type a floating point type?
+     *
+     * @param type Column type as returned by RDataFrame
+     * @return true
+     * @return false
+     */
+    bool isFloatingType(const std::string& type) {
+        return type == "double" || type == "Double_t" || type == "float" || type == "Float_t";
+    }
+}
+
+WeightExpression::WeightExpression(const std::string& formula) :
+m_formula(formula),
+m_isValid(false),
+m_constant(1.)
+{
+    std::size_t position(0);
+    IntegerTerms terms;
+    m_isValid = this->parseProduct(position, false, &terms);
+    this->skipSpaces(position);
+    if (position != m_formula.size()) {
+        m_isValid = false;
+    }
+
+    if (!m_isValid) {
+        LOG(DEBUG) << "Formula: " << m_formula << " is not a product of columns, it will be JIT compiled\n";
+    }
+}
+
+WeightExpression WeightExpression::withColumns(const std::vector<std::string>& columns, const std::string& formula) const {
+    if (columns.size() != m_columns.size()) {
+        LOG(ERROR) << "Expected " << m_columns.size() << " columns for the weight formula: " << m_formula << ", got " << columns.size() << "\n";
+        throw std::invalid_argument("");
+    }
+
+    WeightExpression result(*this);
+    result.m_formula = formula;
+    result.m_columns = columns;
+
+    return result;
+}
+
+WeightExpression WeightExpression::multiply(const WeightExpression& other) const {
+    WeightExpression result(*this);
+    result.m_formula = "(" + m_formula + ")*(" + other.m_formula + ")";
+    result.m_isValid = m_isValid && other.m_isValid;
+    result.m_constant = m_constant * other.m_constant;
+    result.m_columns.insert(result.m_columns.end(), other.m_columns.begin(), other.m_columns.end());
+    result.m_inverted.insert(result.m_inverted.end(), other.m_inverted.begin(), other.m_inverted.end());
+    for (const auto& idivision : other.m_integerDivisions) {
+        std::vector<std::size_t> columns;
+        for (const std::size_t index : idivision) {
+            columns.emplace_back(index + m_columns.size());
+        }
+        result.m_integerDivisions.emplace_back(std::move(columns));
+    }
+
+    return result;
+}
+
+bool WeightExpression::isCompilable(ROOT::RDF::RNode node) const {
+    if (!m_isValid) return false;
+    if (m_columns.size() > maxColumns) return false;
+
+    for (const auto& icolumn : m_columns) {
+        if (!node.HasColumn(icolumn)) return false;
+        if (!isSupportedType(node.GetColumnType(icolumn))) return false;
+    }
+
+    // the compiled product uses doubles, integer divisions (e.g. "1/2" = 0) are left to the JIT
+    for (const auto& idivision : m_integerDivisions) {
+        const bool isInteger = std::none_of(idivision.begin(), idivision.end(), [this, &node](const std::size_t index) {
+            return isFloatingType(node.GetColumnType(m_columns.at(index)));
+        });
+        if (isInteger) {
+            LOG(DEBUG) << "Formula: " << m_formula << " contains an integer division, it will be JIT compiled\n";
+            return false;
+        }
+    }
+
+    return true;
+}
+
+ROOT::RDF::RNode WeightExpression::define(ROOT::RDF::RNode node, const std::string& name) const {
+
+    std::vector<std::string> doubleColumns;
+    for (const auto& icolumn : m_columns) {
+        const std::string type = node.GetColumnType(icolumn);
+        if (type == "double" || type == "Double_t") {
+            doubleColumns.emplace_back(icolumn);
+            continue;
+        }
+
+        const std::string converted = WeightExpression::doubleColumnName(icolumn);
+        doubleColumns.emplace_back(converted);
+        if (node.HasColumn(converted)) continue;
+
+        if (type == "float" || type == "Float_t") node = defineAsDouble<float>(node, converted, icolumn);
+        else if (type == "int" || type == "Int_t") node = defineAsDouble<int>(node, converted, icolumn);
+        else if (type == "unsigned int" || type == "UInt_t") node = defineAsDouble<unsigned int>(node, converted, icolumn);
+        else if (type == "long" || type == "Long_t") node = defineAsDouble<long>(node, converted, icolumn);
+        else if (type == "long long" || type == "Long64_t") node = defineAsDouble<long long>(node, converted, icolumn);
+        else if (type == "unsigned long" || type == "ULong_t") node = defineAsDouble<unsigned long>(node, converted, icolumn);
+        else if (type == "unsigned long long" || type == "ULong64_t") node = defineAsDouble<unsigned long long>(node, converted, icolumn);
+        else if (type == "short" || type == "Short_t") node = defineAsDouble<short>(node, converted, icolumn);
+        else if (type == "unsigned short" || type == "UShort_t") node = defineAsDouble<unsigned short>(node, converted, icolumn);
+        else if (type == "char" || type == "Char_t") node = defineAsDouble<char>(node, converted, icolumn);
+        else if (type == "unsigned char" || type == "UChar_t") node = defineAsDouble<unsigned char>(node, converted, icolumn);
+        else if (type == "bool" || type == "Bool_t") node = defineAsDouble<bool>(node, converted, icolumn);
+        else {
+            LOG(ERROR) << "Unsupported type: " << type << " of column: " << icolumn << " for the compiled weight\n";
+            throw std::invalid_argument("");
+        }
+    }
+
+    return this->dispatchProduct<maxColumns>(node, name, doubleColumns);
+}
+
+bool WeightExpression::parseProduct(std::size_t& position, const bool inverted, IntegerTerms* terms) {
+    // terms of the product evaluated so far (left to right, as in C++)
+    IntegerTerms left;
+    if (!this->parseFactor(position, inverted, &left)) return false;
+
+    auto merge = [](IntegerTerms* to, const IntegerTerms& from) {
+        to->literalsAreIntegers = to->literalsAreIntegers && from.literalsAreIntegers;
+        to->columns.insert(to->columns.end(), from.columns.begin(), from.columns.end());
+    };
+
+    while (true) {
+        this->skipSpaces(position);
+        if (position >= m_formula.size()) break;
+
+        const char op = m_formula.at(position);
+        if (op != '*' && op != '/') break;
+        ++position;
+
+        // a/b/c = a*(1/b)*(1/c), a/(b*c) = a*(1/b)*(1/c)
+        IntegerTerms right;
+        if (!this->parseFactor(position, op == '/' ? !inverted : inverted, &right)) return false;
+
+        if (op == '/' && left.literalsAreIntegers && right.literalsAreIntegers) {
+            std::vector<std::size_t> columns(left.columns);
+            columns.insert(columns.end(), right.columns.begin(), right.columns.end());
+            m_integerDivisions.emplace_back(std::move(columns));
+        }
+        merge(&left, right);
+    }
+
+    merge(terms, left);
+    return true;
+}
+
+bool WeightExpression::parseFactor(std::size_t& position, const bool inverted, IntegerTerms* terms) {
+    this->skipSpaces(position);
+    if (position >= m_formula.size()) return false;
+
+    const char first = m_formula.at(position);
+
+    // product in parentheses
+    if (first == '(') {
+        ++position;
+        if (!this->parseProduct(position, inverted, terms)) return false;
+        this->skipSpaces(position);
+        if (position >= m_formula.size() || m_formula.at(position) != ')') return false;
+        ++position;
+        return true;
+    }
+
+    // column name
+    if (std::isalpha(static_cast<unsigned char>(first)) || first == '_') {
+        const std::size_t start = position;
+        while (position < m_formula.size() &&
+               (std::isalnum(static_cast<unsigned char>(m_formula.at(position))) || m_formula.at(position) == '_')) {
+            ++position;
+        }
+        terms->columns.emplace_back(m_columns.size());
+        m_columns.emplace_back(m_formula.substr(start, position - start));
+        m_inverted.emplace_back(inverted);
+        return true;
+    }
+
+    // number
+    if (std::isdigit(static_cast<unsigned char>(first)) || first == '.') {
+        const char* begin = m_formula.c_str() + position;
+        char* end = nullptr;
+        const double value = std::strtod(begin, &end);
+        if (end == begin) return false;
+        const std::string literal = m_formula.substr(position, end - begin);
+        position += end - begin;
+        bool isFloating = literal.find_first_of(".eEpP") != std::string::npos;
+        // hexadecimal digits can contain "e"
+        if (literal.size() > 1 && literal.at(0) == '0' && (literal.at(1) == 'x' || literal.at(1) == 'X')) {
+            isFloating = literal.find_first_of(".pP") != std::string::npos;
+        }
+        if (position < m_formula.size() && (m_formula.at(position) == 'f' || m_formula.at(position) == 'F')) {
+            ++position;
+            isFloating = true;
+        }
+        terms->literalsAreIntegers = terms->literalsAreIntegers && !isFloating;
+        if (inverted) {
+            if (value == 0) return false;
+            m_constant /= value;
+        } else {
+            m_constant *= value;
+        }
+        return true;
+    }
+
+    return false;
+}
+
+void WeightExpression::skipSpaces(std::size_t& position) const {
+    while (position < m_formula.size() && std::isspace(static_cast<unsigned char>(m_formula.at(position)))) {
+        ++position;
+    }
+}
+
+std::string WeightExpression::doubleColumnName(const std::string& column) {
+    return "weightExpression_double_" + column;
+}
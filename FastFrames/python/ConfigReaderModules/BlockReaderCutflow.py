@@ -68,6 +68,8 @@ class BlockReaderCutflow:
 
                 self._cuts_vector.append(BlockReaderCutflow.CutInCutflow(associated_variable, variables_to_exclude, title, selection))
 
+        self._systematics = self._options_getter.get("systematics", False, [bool])
+
         self._sample_names = self._options_getter.get("samples", None, [list], [str])
         CommandLineOptions().keep_only_selected_samples(self._sample_names)
 
@@ -210,6 +212,8 @@ class BlockReaderCutflow:
     def __set_config_reader_cpp(self) -> None:
         """!Set the options in the C++ class
         """
+        self.cpp_class.setSystematics(self._systematics)
+
         for selection_tuple in self._selections_list:
             options_getter = BlockOptionsGetter(selection_tuple)
             selection = options_getter.get("selection", None, [str])
@@ -262,6 +266,8 @@ class BlockReaderCutflow:
         selections_titles = cpp_class.selectionsTitles()
 
         print(indent + cpp_class.name())
+        if cpp_class.systematics():
+            print(indent + "systematics: True")
         if cutflow_object.has_variables_to_track():
             print(indent + "variables_to_track: ")
             for i in range(len(variables_to_track)):
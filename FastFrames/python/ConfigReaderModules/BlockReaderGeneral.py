@@ -61,6 +61,14 @@ class BlockReaderGeneral:
         self._ntuple_auto_flush = self._options_getter.get("ntuple_auto_flush", None, [int])
         self._split_processing_per_unique_samples = self._options_getter.get("split_processing_per_unique_samples", False, [bool])
         self._convert_vector_to_rvec = self._options_getter.get("convert_vector_to_rvec", False, [bool])
+        self._max_concurrent_graphs = self._options_getter.get("max_concurrent_graphs", 1, [int])
+        self._vectorise_systematic_histograms = self._options_getter.get("vectorise_systematic_histograms", False, [bool])
+        self._jit_cache_directory = self._options_getter.get("jit_cache_directory", "", [str])
+        self._compiled_code_path = self._options_getter.get("compiled_code_path", "", [str])
+        self._ntuple_format = self._options_getter.get("ntuple_format", "ttree", [str])
+        self._cache_truth_index = self._options_getter.get("cache_truth_index", False, [bool])
+        self._split_jobs_by_entries = self._options_getter.get("split_jobs_by_entries", True, [bool])
+        self._region_bitmask = self._options_getter.get("region_bitmask", False, [bool])
 
         ## Default value for sumweights -> can be overriden in sample block
         self.default_sumweights = self._options_getter.get("default_sumweights", "NOSYS", [str])
@@ -135,6 +143,20 @@ class BlockReaderGeneral:
         self.cpp_class.setUseRegionSubfolders(self._use_region_subfolders)
         self.cpp_class.setSplitProcessingPerUniqueSample(self._split_processing_per_unique_samples)
         self.cpp_class.setConvertVectorToRVec(self._convert_vector_to_rvec)
+        if self._max_concurrent_graphs < 1:
+            Logger.log_message("ERROR", "max_concurrent_graphs has to be at least 1, got {}".format(self._max_concurrent_graphs))
+            exit(1)
+        self.cpp_class.setMaxConcurrentGraphs(self._max_concurrent_graphs)
+        self.cpp_class.setVectoriseSystematicHistograms(self._vectorise_systematic_histograms)
+        self.cpp_class.setJitCacheDirectory(self._jit_cache_directory)
+        self.cpp_class.setCompiledCodePath(self._compiled_code_path)
+        if self._ntuple_format not in ["ttree", "rntuple"]:
+            Logger.log_message("ERROR", "ntuple_format has to be either \"ttree\" or \"rntuple\", got {}".format(self._ntuple_format))
+            exit(1)
+        self.cpp_class.setNtupleFormat(self._ntuple_format)
+        self.cpp_class.setCacheTruthIndex(self._cache_truth_index)
+        self.cpp_class.setSplitJobsByEntries(self._split_jobs_by_entries)
+        self.cpp_class.setRegionBitmask(self._region_bitmask)
 
         for campaign, lumi_value in self._luminosity_map.items():
             self.cpp_class.setLuminosity(campaign, lumi_value, True)
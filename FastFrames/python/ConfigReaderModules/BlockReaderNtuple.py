@@ -45,6 +45,7 @@ class BlockReaderNtuple:
         self._branches = self._options_getter.get("branches",[], [list], [str])
         self._exclude_branches = self._options_getter.get("exclude_branches",[], [list], [str])
         self._copy_trees = self._options_getter.get("copy_trees",[], [list], [str])
+        self._outputs = self._read_outputs(self._options_getter.get("outputs",[], [list], [dict]))
 
         self._check_unused_options()
 
@@ -61,6 +62,59 @@ class BlockReaderNtuple:
         for tree in self._copy_trees:
             self.cpp_class.addCopyTree(tree)
 
+    def _read_outputs(self, outputs_list : list) -> list:
+        """!Read the named outputs, the options not specified for an output are taken from the ntuple block
+        @param outputs_list: list of dictionaries from the config file
+        @return list of dictionaries with the options of the outputs
+        """
+        result = []
+        names = set()
+        for output_dict in outputs_list:
+            options_getter = BlockOptionsGetter(output_dict)
+            name = options_getter.get("name", None, [str])
+            if name is None:
+                Logger.log_message("ERROR", "Output in ntuple block has no name")
+                exit(1)
+            if name in names:
+                Logger.log_message("ERROR", "Duplicate output name {} in ntuple block".format(name))
+                exit(1)
+            names.add(name)
+
+            output = {}
+            output["name"] = name
+            output["selection"] = options_getter.get("selection", None, [str])
+            output["regions"] = options_getter.get("regions", None, [list], [str])
+            if output["selection"] is not None and output["regions"] is not None:
+                Logger.log_message("ERROR", "Both regions and selection specified for output {} in ntuple block".format(name))
+                exit(1)
+            output["file_suffix"] = options_getter.get("file_suffix", "_" + name, [str])
+            output["branches"] = options_getter.get("branches", self._branches, [list], [str])
+            output["exclude_branches"] = options_getter.get("exclude_branches", self._exclude_branches, [list], [str])
+
+            unused = options_getter.get_unused_options()
+            if len(unused) > 0:
+                Logger.log_message("ERROR", "Key {} used in output {} of ntuple block is not supported!".format(unused, name))
+                exit(1)
+            result.append(output)
+        return result
+
+    @staticmethod
+    def _selection_from_regions(region_names : list, regions : dict) -> str:
+        """!Combine selections of the regions with OR
+        @param region_names: names of the regions to combine
+        @param regions: dictionary with all regions (keys are region names, values are BlockReaderRegion objects)
+        @return the combined selection
+        """
+        selections = []
+        for region_name in region_names:
+            if region_name not in regions:
+                Logger.log_message("ERROR", "Unknown region {} specified in ntuple block".format(region_name))
+                exit(1)
+            region_selection = regions[region_name].cpp_class.selection()
+            if region_selection != "":
+                selections.append("(" + region_selection + ")")
+        return "({})".format(" || ".join(selections))
+
     def _check_unused_options(self) -> None:
         unused = self._options_getter.get_unused_options()
         if len(unused) > 0:
@@ -74,17 +128,22 @@ class BlockReaderNtuple:
         """
         # combine selections from all regions
         if self._regions:
-            selections = []
-            for region_name in self._regions:
-                if region_name not in regions:
-                    Logger.log_message("ERROR", "Unknown region {} specified in ntuple block".format(region_name))
-                    exit(1)
-                region_selection = regions[region_name].cpp_class.selection()
-                if region_selection != "":
-                    selections.append("(" + regions[region_name].cpp_class.selection() + ")")
-            self._selection = "({})".format(" || ".join(selections))
+            self._selection = BlockReaderNtuple._selection_from_regions(self._regions, regions)
         self.cpp_class.setSelection(self._selection)
 
+        # the outputs are added here as their selection can also depend on the regions
+        for output in self._outputs:
+            selection = output["selection"]
+            if output["regions"]:
+                selection = BlockReaderNtuple._selection_from_regions(output["regions"], regions)
+            if selection is None:
+                selection = self._selection
+            self.cpp_class.addOutput(output["name"], selection, output["file_suffix"])
+            for branch in output["branches"]:
+                self.cpp_class.addOutputBranch(branch)
+            for branch in output["exclude_branches"]:
+                self.cpp_class.addOutputExcludedBranch(branch)
+
     def adjust_samples(self, samples : dict) -> None:
         """!Adjust list of samples for which ntuple step should be run. If samples are specified, check if they exist. If no samples are specified, take all samples.
         @param samples: dictionary with all samples (keys are sample names)
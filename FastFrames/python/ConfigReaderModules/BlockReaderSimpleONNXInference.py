@@ -6,6 +6,7 @@ from BlockReaderCommon import set_paths
 set_paths()
 
 from ConfigReaderCpp import SimpleONNXInferenceWrapper
+from python_wrapper.python.logger import Logger
 from BlockOptionsGetter import BlockOptionsGetter
 
 def vector_to_list(cpp_vector) -> list:
@@ -38,3 +39,17 @@ class BlockReaderSimpleONNXInference:
         outputs_dict = self._options_getter.get("outputs", {}, [dict])
         for key, value in outputs_dict.items():
             self.cpp_class.addOutput(key, value)
+
+        intra_op_threads = self._options_getter.get("intra_op_threads", 1, [int])
+        inter_op_threads = self._options_getter.get("inter_op_threads", 1, [int])
+        if intra_op_threads < 1 or inter_op_threads < 1:
+            Logger.log_message("ERROR", "intra_op_threads and inter_op_threads have to be at least 1 for model: {}".format(self._name))
+            exit(1)
+        self.cpp_class.setIntraOpThreads(intra_op_threads)
+        self.cpp_class.setInterOpThreads(inter_op_threads)
+        graph_optimization_level = self._options_getter.get("graph_optimization_level", "extended", [str])
+        if graph_optimization_level not in ["disable", "basic", "extended", "all"]:
+            Logger.log_message("ERROR", "Unknown graph_optimization_level: {} for model: {}".format(graph_optimization_level, self._name))
+            exit(1)
+        self.cpp_class.setGraphOptimizationLevel(graph_optimization_level)
+        self.cpp_class.setOptimizedModelDirectory(self._options_getter.get("optimized_model_directory", "", [str]))
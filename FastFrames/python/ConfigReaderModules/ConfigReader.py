@@ -190,6 +190,14 @@ if __name__ == "__main__":
     print("\tntuple_auto_flush:", block_general.cpp_class.ntupleAutoFlush())
     print("\tsplit_processing_per_unique_samples:", block_general.cpp_class.splitProcessingPerUniqueSample())
     print("\tconvert_vector_to_rvec: ", block_general.cpp_class.convertVectorToRVec())
+    print("\tmax_concurrent_graphs:", block_general.cpp_class.maxConcurrentGraphs())
+    print("\tvectorise_systematic_histograms:", block_general.cpp_class.vectoriseSystematicHistograms())
+    print("\tjit_cache_directory:", block_general.cpp_class.jitCacheDirectory())
+    print("\tcompiled_code_path:", block_general.cpp_class.compiledCodePath())
+    print("\tntuple_format:", block_general.cpp_class.ntupleFormat())
+    print("\tcache_truth_index:", block_general.cpp_class.cacheTruthIndex())
+    print("\tsplit_jobs_by_entries:", block_general.cpp_class.splitJobsByEntries())
+    print("\tregion_bitmask:", block_general.cpp_class.regionBitmask())
     print("\tluminosity, mc20a: ", block_general.cpp_class.getLuminosity("mc20a"))
     print("\tluminosity, mc20d: ", block_general.cpp_class.getLuminosity("mc20d"))
 
@@ -213,6 +221,10 @@ if __name__ == "__main__":
             print("\tmodel_paths: ")
             for model_path in onnx_interface.modelPaths():
                 print("\t\t", model_path)
+            print("\tintra_op_threads: ", onnx_interface.intraOpThreads())
+            print("\tinter_op_threads: ", onnx_interface.interOpThreads())
+            print("\tgraph_optimization_level: ", onnx_interface.graphOptimizationLevel())
+            print("\toptimized_model_directory: ", onnx_interface.optimizedModelDirectory())
 
             # print input layers
             print("\tInput layers: (name, [branches]) ")
@@ -244,12 +256,20 @@ if __name__ == "__main__":
 
         print("\tcopy_trees: ", config_reader.block_ntuple.get_copy_trees())
 
+        for i_output in range(ntuple_cpp_object.nOutputs()):
+            print("\toutput: ", ntuple_cpp_object.outputName(i_output))
+            print("\t\tselection: ", ntuple_cpp_object.outputSelection(i_output))
+            print("\t\tfile_suffix: ", ntuple_cpp_object.outputFileSuffix(i_output))
+            print("\t\tbranches: [", ",".join(ntuple_cpp_object.outputBranches(i_output)), "]")
+            print("\t\texcluded_branches: [", ",".join(ntuple_cpp_object.outputExcludedBranches(i_output)), "]")
+
 
     print("\n\nRegions block:\n")
     regions = config_reader.block_general.get_regions_cpp_objects()
     for region in regions:
         print("\tname: ", region.name())
         print("\tselection: ", region.selection())
+        print("\tselection_parts: ", vector_to_list(region.selectionParts()))
         print("\tvariables:")
         variable_cpp_objects = BlockReaderRegion.get_variable_cpp_objects(region.getVariableRawPtrs())
         for variable_cpp_object in variable_cpp_objects:
@@ -5,7 +5,7 @@
 import os
 import sys
 
-from ROOT import TFile
+from ROOT import TFile, TNamed, TObject
 
 this_dir = "/".join(os.path.dirname(os.path.abspath(__file__)).split("/")[0:-1])
 sys.path.append(this_dir)
@@ -59,6 +59,10 @@ def get_sample_name_to_list_of_subjob_outputs(original_root_files : list[str], s
                     exit(1)
             job_indices.append(job_index_file)
 
+        if njobs == None:
+            Logger.log_message("ERROR", "No outputs of the jobs found for sample " + sample_name)
+            exit(1)
+
         # check if all job indices are present
         for i_job in range(njobs):
             if i_job not in job_indices:
@@ -68,17 +72,110 @@ def get_sample_name_to_list_of_subjob_outputs(original_root_files : list[str], s
         result[sample_name] = files_unmerged
     return result
 
-def merge_files(input_files : list[str], output_file : str, truth_blocks : dict[str,list[tuple[str,str]]] = None, regions : list[str] = None) -> None:
+def get_job_entry_ranges(file_name : str, object_name : str = "job_entry_ranges") -> list[tuple[str, int, int, int]]:
+    """!Read the entry ranges stored in the output file of a job when the jobs are split by entries
+    @param file_name: path to the output file of the job
+    @param object_name: name of the stored ranges, "job_entry_ranges" for the ranges processed by the job, "job_input_ranges" for the full input of all the jobs
+    @return list[tuple[str, int, int, int]] - input file path, first entry, last entry (exclusive) and number of entries of the input file. None if the ranges are not stored
+    """
+    file = TFile.Open(file_name, "READ")
+    if not file:
+        Logger.log_message("ERROR", "Cannot open file: " + file_name)
+        exit(1)
+    ranges_object = file.Get(object_name)
+    if not ranges_object:
+        file.Close()
+        return None
+    result = []
+    for line in ranges_object.GetTitle().splitlines():
+        if line.strip() == "":
+            continue
+        path, first_entry, last_entry, n_entries = line.rsplit(" ", 3)
+        result.append((path, int(first_entry), int(last_entry), int(n_entries)))
+    file.Close()
+    return result
+
+def check_job_entry_ranges(input_files : list[str], sample_name : str, njobs : int) -> str:
+    """!Check that the entry ranges processed by the jobs cover every input file exactly once
+    @param input_files: list of the outputs of the jobs
+    @param sample_name: name of the sample
+    @param njobs: number of jobs the processing was split into
+    @return str - combined entry ranges of all jobs, None if the jobs were not split by entries
+    """
+    if len(input_files) != njobs:
+        Logger.log_message("ERROR", "Found " + str(len(input_files)) + " outputs of the jobs of sample " + sample_name + ", expected " + str(njobs))
+        exit(1)
+
+    all_ranges = {}
+    # the full input is stored by every job, a file covered only by a missing job output is not in all_ranges
+    expected_ranges = None
+    for input_file in input_files:
+        ranges = get_job_entry_ranges(input_file)
+        if ranges == None:
+            return None
+        for path, first_entry, last_entry, n_entries in ranges:
+            all_ranges.setdefault(path, []).append((first_entry, last_entry, n_entries))
+
+        job_input_ranges = get_job_entry_ranges(input_file, "job_input_ranges")
+        if job_input_ranges == None:
+            Logger.log_message("ERROR", "The input files of the jobs are not stored in " + input_file + ", cannot check that no entries are missing")
+            exit(1)
+        job_input_ranges = sorted(job_input_ranges)
+        if expected_ranges == None:
+            expected_ranges = job_input_ranges
+        elif expected_ranges != job_input_ranges:
+            Logger.log_message("ERROR", "The input files of the jobs of sample " + sample_name + " are not the same in all jobs")
+            exit(1)
+
+    for path, first_entry, last_entry, n_entries in (expected_ranges if expected_ranges != None else []):
+        if path not in all_ranges:
+            Logger.log_message("ERROR", "Entries 0 - " + str(n_entries) + " of file " + path + " are missing in the jobs of sample " + sample_name)
+            exit(1)
+        if all_ranges[path][0][2] != n_entries:
+            Logger.log_message("ERROR", "Inconsistent number of entries of file " + path + " in the jobs of sample " + sample_name)
+            exit(1)
+    expected_paths = set(path for path, _, _, _ in (expected_ranges if expected_ranges != None else []))
+    for path in all_ranges:
+        if path not in expected_paths:
+            Logger.log_message("ERROR", "File " + path + " processed by the jobs of sample " + sample_name + " is not in the input of the jobs")
+            exit(1)
+
+    for path, ranges in all_ranges.items():
+        ranges.sort()
+        n_entries = ranges[0][2]
+        processed_up_to = 0
+        for first_entry, last_entry, n_entries_range in ranges:
+            if n_entries_range != n_entries:
+                Logger.log_message("ERROR", "Inconsistent number of entries of file " + path + " in the jobs of sample " + sample_name)
+                exit(1)
+            if first_entry != processed_up_to:
+                Logger.log_message("ERROR", "Entries " + str(min(first_entry, processed_up_to)) + " - " + str(max(first_entry, processed_up_to)) + " of file " + path + " are " + ("missing" if first_entry > processed_up_to else "processed more than once") + " in the jobs of sample " + sample_name)
+                exit(1)
+            processed_up_to = last_entry
+        if processed_up_to != n_entries:
+            Logger.log_message("ERROR", "Entries " + str(processed_up_to) + " - " + str(n_entries) + " of file " + path + " are missing in the jobs of sample " + sample_name)
+            exit(1)
+
+    return "".join(path + " 0 " + str(ranges[0][2]) + " " + str(ranges[0][2]) + "\n" for path, ranges in all_ranges.items())
+
+def merge_files(input_files : list[str], output_file : str, truth_blocks : dict[str,list[tuple[str,str]]] = None, regions : list[str] = None, job_entry_ranges : str = None) -> None:
     """!Merge input files into the output file
     @param input_files: list of input files
     @param output_file: output file
     @param truth_blocks: dictionary, key = truth block name, value = list of tuples, each containing two strings: reco-level name and truth-level name
     @param regions: list of regions
+    @param job_entry_ranges: combined entry ranges processed by the jobs, replaces the ranges of the first job copied by hadd
     """
     command = "hadd -f " + output_file + " " + " ".join(input_files)
     Logger.log_message("DEBUG", "Going to execute: " + command)
     os.system(command)
 
+    if job_entry_ranges != None:
+        file = TFile.Open(output_file, "UPDATE")
+        file.cd()
+        TNamed("job_entry_ranges", job_entry_ranges).Write("", TObject.kOverwrite)
+        file.Close()
+
     if truth_blocks == None:
         return
 
@@ -153,4 +250,6 @@ if __name__ == "__main__":
 
         unmerged_files = [output_path + "/" + filename for filename in sample_to_unmerged_files_list_dict[sample_name]]
         truth_blocks = get_unfolding_info(config_reader, sample_name)
-        merge_files(unmerged_files, merged_file_address, truth_blocks, regions)
+        njobs, _ = get_njobs_and_job_index_from_file_name(sample_to_unmerged_files_list_dict[sample_name][0], sample_name)
+        job_entry_ranges = check_job_entry_ranges(unmerged_files, sample_name, njobs)
+        merge_files(unmerged_files, merged_file_address, truth_blocks, regions, job_entry_ranges)
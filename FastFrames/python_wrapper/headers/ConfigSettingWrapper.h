@@ -593,6 +593,122 @@ class ConfigSettingWrapper {
          */
         inline bool convertVectorToRVec() const {return m_configSetting->convertVectorToRVec();}
 
+        /**
+         * @brief Set the maximum number of sample graphs that are run concurrently
+         *
+         * @param n
+         */
+        inline void setMaxConcurrentGraphs(const int n) {m_configSetting->setMaxConcurrentGraphs(n);}
+
+        /**
+         * @brief Get the maximum number of sample graphs that are run concurrently
+         *
+         * @return int
+         */
+        inline int maxConcurrentGraphs() const {return m_configSetting->maxConcurrentGraphs();}
+
+        /**
+         * @brief Set the flag to fill the 1D histograms for all systematics with one action per region and variable
+         *
+         * @param flag
+         */
+        inline void setVectoriseSystematicHistograms(const bool flag) {m_configSetting->setVectoriseSystematicHistograms(flag);}
+
+        /**
+         * @brief Should the 1D histograms for all systematics be filled with one action per region and variable?
+         *
+         * @return true
+         * @return false
+         */
+        inline bool vectoriseSystematicHistograms() const {return m_configSetting->vectoriseSystematicHistograms();}
+
+        /**
+         * @brief Set the path to the directory with the cached compiled string expressions
+         *
+         * @param directory
+         */
+        inline void setJitCacheDirectory(const std::string& directory) {m_configSetting->setJitCacheDirectory(directory);}
+
+        /**
+         * @brief Get the path to the directory with the cached compiled string expressions (empty = no caching)
+         *
+         * @return const std::string&
+         */
+        inline const std::string& jitCacheDirectory() const {return m_configSetting->jitCacheDirectory();}
+
+        /**
+         * @brief Set the path to the generated C++ file with the compiled expressions
+         *
+         * @param path
+         */
+        inline void setCompiledCodePath(const std::string& path) {m_configSetting->setCompiledCodePath(path);}
+
+        /**
+         * @brief Get the path to the generated C++ file with the compiled expressions (empty = not used)
+         *
+         * @return const std::string&
+         */
+        inline const std::string& compiledCodePath() const {return m_configSetting->compiledCodePath();}
+
+        /**
+         * @brief Set the format of the output ntuples, "ttree" or "rntuple"
+         *
+         * @param format
+         */
+        inline void setNtupleFormat(const std::string& format) {m_configSetting->setNtupleFormat(format);}
+
+        /**
+         * @brief Get the format of the output ntuples, "ttree" or "rntuple"
+         *
+         * @return const std::string&
+         */
+        inline const std::string& ntupleFormat() const {return m_configSetting->ntupleFormat();}
+
+        /**
+         * @brief Set the flag to cache the reco-truth index next to the input files
+         *
+         * @param flag
+         */
+        inline void setCacheTruthIndex(const bool flag) {m_configSetting->setCacheTruthIndex(flag);}
+
+        /**
+         * @brief Cache the reco-truth index next to the input files?
+         *
+         * @return true
+         * @return false
+         */
+        inline bool cacheTruthIndex() const {return m_configSetting->cacheTruthIndex();}
+
+        /**
+         * @brief Set the flag to split the jobs by the entry ranges instead of whole files
+         *
+         * @param flag
+         */
+        inline void setSplitJobsByEntries(const bool flag) {m_configSetting->setSplitJobsByEntries(flag);}
+
+        /**
+         * @brief Split the jobs by the entry ranges instead of whole files?
+         *
+         * @return true
+         * @return false
+         */
+        inline bool splitJobsByEntries() const {return m_configSetting->splitJobsByEntries();}
+
+        /**
+         * @brief Set the flag to evaluate all region selections of a systematic in one bitmask column
+         *
+         * @param flag
+         */
+        inline void setRegionBitmask(const bool flag) {m_configSetting->setRegionBitmask(flag);}
+
+        /**
+         * @brief Evaluate all region selections of a systematic in one bitmask column?
+         *
+         * @return true
+         * @return false
+         */
+        inline bool regionBitmask() const {return m_configSetting->regionBitmask();}
+
 
     private:
         std::shared_ptr<ConfigSetting> m_configSetting;
@@ -96,6 +96,24 @@ class CutflowWrapper {
             return selections;
         }
 
+        /**
+         * @brief Set if the cutflow is produced for all systematic variations
+         *
+         * @param systematics
+         */
+        void setSystematics(const bool systematics) {
+            m_cutflow->setSystematics(systematics);
+        }
+
+        /**
+         * @brief Is the cutflow produced for all systematic variations
+         *
+         * @return bool
+         */
+        bool systematics() const {
+            return m_cutflow->systematics();
+        }
+
 
     private:
         std::shared_ptr<Cutflow> m_cutflow;
@@ -145,6 +145,81 @@ class NtupleWrapper {
          */
         std::vector<std::string> copyTrees() const {return m_ntuple->copyTrees();}
 
+        /**
+         * @brief Add a named output
+         *
+         * @param name Name of the output
+         * @param selection Selection of the output
+         * @param fileSuffix Suffix added to the name of the output file
+         */
+        void addOutput(const std::string& name, const std::string& selection, const std::string& fileSuffix) {
+            auto output = std::make_shared<NtupleOutput>(name);
+            output->setSelection(selection);
+            output->setFileSuffix(fileSuffix);
+            m_ntuple->addOutput(output);
+        }
+
+        /**
+         * @brief Add a branch to the last added output
+         *
+         * @param branch
+         */
+        void addOutputBranch(const std::string& branch) {m_ntuple->outputs().back()->addBranch(branch);}
+
+        /**
+         * @brief Add an excluded branch to the last added output
+         *
+         * @param branch
+         */
+        void addOutputExcludedBranch(const std::string& branch) {m_ntuple->outputs().back()->addExcludedBranch(branch);}
+
+        /**
+         * @brief Get number of the named outputs
+         *
+         * @return unsigned int
+         */
+        unsigned int nOutputs() const {return m_ntuple->outputs().size();}
+
+        /**
+         * @brief Get name of i-th output
+         *
+         * @param i
+         * @return std::string
+         */
+        std::string outputName(unsigned int i) const {return m_ntuple->outputs().at(i)->name();}
+
+        /**
+         * @brief Get selection of i-th output
+         *
+         * @param i
+         * @return std::string
+         */
+        std::string outputSelection(unsigned int i) const {return m_ntuple->outputs().at(i)->selection();}
+
+        /**
+         * @brief Get file suffix of i-th output
+         *
+         * @param i
+         * @return std::string
+         */
+        std::string outputFileSuffix(unsigned int i) const {return m_ntuple->outputs().at(i)->fileSuffix();}
+
+        /**
+         * @brief Get branches of i-th output
+         *
+         * @param i
+         * @return std::vector<std::string>
+         */
+        std::vector<std::string> outputBranches(unsigned int i) const {return m_ntuple->outputs().at(i)->branches();}
+
+        /**
+         * @brief Get excluded branches of i-th output
+         *
+         * @param i
+         * @return std::vector<std::string>
+         */
+        std::vector<std::string> outputExcludedBranches(unsigned int i) const {return m_ntuple->outputs().at(i)->excludedBranches();}
+
 
     private:
         std::shared_ptr<Ntuple> m_ntuple;
@@ -6,6 +6,7 @@
 #pragma once
 
 #include "FastFrames/Region.h"
+#include "FastFrames/StringOperations.h"
 
 
 #include <string>
@@ -80,6 +81,16 @@ class RegionWrapper {
             return m_region->selection();
         };
 
+        /**
+         * @brief Returns the parts of the selection joined by a top-level "&&".
+         * The filters of the common parts are shared between the regions
+         *
+         * @return std::vector<std::string> The parts of the selection
+         */
+        std::vector<std::string> selectionParts() const {
+            return StringOperations::splitConjunction(m_region->selection());
+        };
+
         /**
          * @brief Add variable to the region, given the raw pointer to the shared_ptr<Variable>
          *
@@ -123,6 +123,38 @@ class SimpleONNXInferenceWrapper {
             m_inference->setFoldFormula(foldFormula);
         }
 
+        void setIntraOpThreads(const int threads) {
+            m_inference->setIntraOpThreads(threads);
+        }
+
+        int intraOpThreads() const {
+            return m_inference->intraOpThreads();
+        }
+
+        void setInterOpThreads(const int threads) {
+            m_inference->setInterOpThreads(threads);
+        }
+
+        int interOpThreads() const {
+            return m_inference->interOpThreads();
+        }
+
+        void setGraphOptimizationLevel(const std::string& level) {
+            m_inference->setGraphOptimizationLevel(level);
+        }
+
+        std::string graphOptimizationLevel() const {
+            return m_inference->graphOptimizationLevel();
+        }
+
+        void setOptimizedModelDirectory(const std::string& directory) {
+            m_inference->setOptimizedModelDirectory(directory);
+        }
+
+        std::string optimizedModelDirectory() const {
+            return m_inference->optimizedModelDirectory();
+        }
+
     private:
         std::shared_ptr<SimpleONNXInference> m_inference;
 
@@ -213,6 +213,30 @@ BOOST_PYTHON_MODULE(ConfigReaderCpp) {
 
         .def("setConvertVectorToRVec",          &ConfigSettingWrapper::setConvertVectorToRVec)
         .def("convertVectorToRVec",             &ConfigSettingWrapper::convertVectorToRVec)
+
+        .def("setMaxConcurrentGraphs",          &ConfigSettingWrapper::setMaxConcurrentGraphs)
+        .def("maxConcurrentGraphs",             &ConfigSettingWrapper::maxConcurrentGraphs)
+
+        .def("setVectoriseSystematicHistograms",  &ConfigSettingWrapper::setVectoriseSystematicHistograms)
+        .def("vectoriseSystematicHistograms",     &ConfigSettingWrapper::vectoriseSystematicHistograms)
+
+        .def("setJitCacheDirectory",              &ConfigSettingWrapper::setJitCacheDirectory)
+        .def("jitCacheDirectory",                 &ConfigSettingWrapper::jitCacheDirectory)
+
+        .def("setCompiledCodePath",               &ConfigSettingWrapper::setCompiledCodePath)
+        .def("compiledCodePath",                  &ConfigSettingWrapper::compiledCodePath)
+
+        .def("setNtupleFormat",                   &ConfigSettingWrapper::setNtupleFormat)
+        .def("ntupleFormat",                      &ConfigSettingWrapper::ntupleFormat)
+
+        .def("setCacheTruthIndex",                &ConfigSettingWrapper::setCacheTruthIndex)
+        .def("cacheTruthIndex",                   &ConfigSettingWrapper::cacheTruthIndex)
+
+        .def("setSplitJobsByEntries",             &ConfigSettingWrapper::setSplitJobsByEntries)
+        .def("splitJobsByEntries",                &ConfigSettingWrapper::splitJobsByEntries)
+
+        .def("setRegionBitmask",                  &ConfigSettingWrapper::setRegionBitmask)
+        .def("regionBitmask",                     &ConfigSettingWrapper::regionBitmask)
     ;
 
     /**
@@ -233,6 +257,7 @@ BOOST_PYTHON_MODULE(ConfigReaderCpp) {
         // selection
         .def("selection",       &RegionWrapper::selection)
         .def("setSelection",    &RegionWrapper::setSelection)
+        .def("selectionParts",  &RegionWrapper::selectionParts)
 
         // addVariable
         .def("addVariable",         &RegionWrapper::addVariable)
@@ -441,6 +466,17 @@ BOOST_PYTHON_MODULE(ConfigReaderCpp) {
         // copyTree
         .def("addCopyTree",     &NtupleWrapper::addCopyTree)
         .def("copyTrees",       &NtupleWrapper::copyTrees)
+
+        // outputs
+        .def("addOutput",               &NtupleWrapper::addOutput)
+        .def("addOutputBranch",         &NtupleWrapper::addOutputBranch)
+        .def("addOutputExcludedBranch", &NtupleWrapper::addOutputExcludedBranch)
+        .def("nOutputs",                &NtupleWrapper::nOutputs)
+        .def("outputName",              &NtupleWrapper::outputName)
+        .def("outputSelection",         &NtupleWrapper::outputSelection)
+        .def("outputFileSuffix",        &NtupleWrapper::outputFileSuffix)
+        .def("outputBranches",          &NtupleWrapper::outputBranches)
+        .def("outputExcludedBranches",  &NtupleWrapper::outputExcludedBranches)
     ;
 
     /**
@@ -513,6 +549,10 @@ BOOST_PYTHON_MODULE(ConfigReaderCpp) {
         // selections
         .def("selectionsDefinition",      &CutflowWrapper::selectionsDefinition)
         .def("selectionsTitles",          &CutflowWrapper::selectionsTitles)
+
+        // systematics
+        .def("setSystematics",  &CutflowWrapper::setSystematics)
+        .def("systematics",     &CutflowWrapper::systematics)
     ;
 
     /**
@@ -568,6 +608,15 @@ BOOST_PYTHON_MODULE(ConfigReaderCpp) {
         .def("modelPaths",              &SimpleONNXInferenceWrapper::modelPaths)
         .def("setFoldFormula",          &SimpleONNXInferenceWrapper::setFoldFormula)
 
+        .def("setIntraOpThreads",               &SimpleONNXInferenceWrapper::setIntraOpThreads)
+        .def("intraOpThreads",                  &SimpleONNXInferenceWrapper::intraOpThreads)
+        .def("setInterOpThreads",               &SimpleONNXInferenceWrapper::setInterOpThreads)
+        .def("interOpThreads",                  &SimpleONNXInferenceWrapper::interOpThreads)
+        .def("setGraphOptimizationLevel",       &SimpleONNXInferenceWrapper::setGraphOptimizationLevel)
+        .def("graphOptimizationLevel",          &SimpleONNXInferenceWrapper::graphOptimizationLevel)
+        .def("setOptimizedModelDirectory",      &SimpleONNXInferenceWrapper::setOptimizedModelDirectory)
+        .def("optimizedModelDirectory",         &SimpleONNXInferenceWrapper::optimizedModelDirectory)
+
         .def("addInput",                &SimpleONNXInferenceWrapper::addInput)
         .def("getInputLayerNames",      &SimpleONNXInferenceWrapper::getInputLayerNames)
         .def("getInputLayerBranches",   &SimpleONNXInferenceWrapper::getInputLayerBranches)
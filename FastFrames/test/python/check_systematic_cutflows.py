@@ -0,0 +1,74 @@
+"""!Script for checking the cutflows produced for the systematic variations.
+The nominal row of every systematic cutflow (Cutflow_<name>_systematics) must be identical to the nominal cutflow (Cutflow_<name>).
+If any difference is found, it will print out the first difference and return a non-zero exit code.
+
+Usage:
+    python3 check_systematic_cutflows.py <file>
+"""
+from ROOT import TFile, TH1D, TH2D
+import sys
+
+from compare_two_root_files import floats_are_equal, get_list_of_objects_in_tdirectory
+
+def compare_nominal_row(nominal : TH1D, systematics : TH2D, nominal_name : str = "NOSYS") -> str:
+    """
+    Compare the nominal row of the systematic cutflow to the nominal cutflow. If they are different, return a string explaining the first difference found. If identical, return None
+    """
+    if nominal.GetNbinsX() != systematics.GetNbinsX():
+        return "Cutflows have different number of steps"
+
+    nominal_bin = None
+    for ibin_y in range(1, systematics.GetNbinsY()+1):
+        if systematics.GetYaxis().GetBinLabel(ibin_y) == nominal_name:
+            nominal_bin = ibin_y
+            break
+    if nominal_bin == None:
+        return f"Systematic cutflow does not contain {nominal_name}"
+
+    for ibin_x in range(1, nominal.GetNbinsX()+1):
+        if nominal.GetXaxis().GetBinLabel(ibin_x) != systematics.GetXaxis().GetBinLabel(ibin_x):
+            return f"Cutflows have different step titles at bin {ibin_x}: {nominal.GetXaxis().GetBinLabel(ibin_x)} != {systematics.GetXaxis().GetBinLabel(ibin_x)}"
+        if not floats_are_equal(nominal.GetBinContent(ibin_x), systematics.GetBinContent(ibin_x, nominal_bin)):
+            return f"Cutflows have different yields at bin {ibin_x}: {nominal.GetBinContent(ibin_x)} != {systematics.GetBinContent(ibin_x, nominal_bin)}"
+        if not floats_are_equal(nominal.GetBinError(ibin_x), systematics.GetBinError(ibin_x, nominal_bin)):
+            return f"Cutflows have different uncertainties at bin {ibin_x}: {nominal.GetBinError(ibin_x)} != {systematics.GetBinError(ibin_x, nominal_bin)}"
+    return None
+
+def test_systematic_cutflows(file_name : str) -> str:
+    """
+    Check all systematic cutflows in a ROOT file, return a string explaining the first difference found. If all are consistent, return None
+    """
+    tfile = TFile.Open(file_name)
+    if not tfile or tfile.IsZombie():
+        return f"File {file_name} could not be opened"
+
+    suffix = "_systematics"
+    systematic_cutflows = [name for name in get_list_of_objects_in_tdirectory(tfile, "TH2D") if name.startswith("Cutflow_") and name.endswith(suffix)]
+    if len(systematic_cutflows) == 0:
+        return f"File {file_name} does not contain any systematic cutflows"
+
+    for systematic_name in systematic_cutflows:
+        nominal_name = systematic_name[:-len(suffix)]
+        nominal = tfile.Get(nominal_name)
+        if not nominal:
+            return f"Nominal cutflow {nominal_name} not found"
+        result = compare_nominal_row(nominal, tfile.Get(systematic_name))
+        if result:
+            return f"Cutflows {nominal_name} and {systematic_name} are different: {result}"
+
+    tfile.Close()
+
+    return None
+
+
+if __name__ == "__main__":
+    if len(sys.argv) != 2:
+        print("Usage: python check_systematic_cutflows.py <file>")
+        sys.exit(1)
+
+    check_result = test_systematic_cutflows(sys.argv[1])
+    if check_result:
+        print(check_result)
+        sys.exit(1)
+    else:
+        print("Systematic cutflows are consistent")
@@ -1,13 +1,19 @@
 """!Script for comparing two ROOT files.
-It will compare all histograms and trees in the files and if any difference is found, it will print out the first difference and return a non-zero exit code.
+It will compare all histograms and trees (TTrees or RNTuples) in the files and if any difference is found, it will print out the first difference and return a non-zero exit code.
 Two identical files will return a zero exit code and print out success message.
 
 Usage:
-    python3 compare_two_root_files.py <file1> <file2>
+    python3 compare_two_root_files.py <file1> <file2> [<ignored object> ...]
+
+The ignored objects are the names of the folders or of the histograms (outside of the folders or in every folder) that are not compared,
+e.g. the objects that are only produced with an additional option.
 """
-from ROOT import TFile, TTree, TH1D, TH2D, TH3D, TDirectory
+from ROOT import TFile, TTree, TH1D, TH2D, TH3D, TDirectory, RDataFrame
 import sys
 
+# class names of the RNTuple anchors in the different ROOT versions
+RNTUPLE_CLASS_NAMES = ["ROOT::RNTuple", "ROOT::Experimental::RNTuple"]
+
 def floats_are_equal(val1 : float, val2 : float, tolerance : float = 1e-5) -> bool:
     """
     Compare two floats and return True if they are equal within the given tolerance
@@ -58,6 +64,55 @@ def test_compare_trees(tree_1 : TTree, tree_2 : TTree) -> str:
                 return f"Branch '{branch_name}' in tree '{tree_1.GetName()}' has different values for entry {i}: {val1} != {val2}"
     return None
 
+def values_are_equal(val1, val2) -> bool:
+    """
+    Compare two numbers or two collections of numbers (e.g. vector branches) within the default tolerance
+    """
+    if hasattr(val1, "__len__") or hasattr(val2, "__len__"):
+        if len(val1) != len(val2):
+            return False
+        return all(floats_are_equal(float(element1), float(element2)) for element1, element2 in zip(val1, val2))
+    return floats_are_equal(float(val1), float(val2))
+
+def get_dataset_columns(file_name : str, dataset_name : str) -> dict:
+    """
+    Read all top-level columns of a TTree or an RNTuple into numpy arrays using RDataFrame
+    """
+    data_frame = RDataFrame(dataset_name, file_name)
+    # the RNTuple data source adds the columns of the sub-fields and of the collection sizes
+    column_names = [str(name) for name in data_frame.GetColumnNames() if "." not in str(name) and not str(name).startswith("R_rdf_") and not str(name).startswith("#")]
+    return data_frame.AsNumpy(column_names)
+
+def test_compare_datasets(file_name_1 : str, file_name_2 : str, dataset_name : str) -> str:
+    """
+    Compare two datasets with the same name (each of them a TTree or an RNTuple) using RDataFrame.
+    The entries are matched by eventNumber. If they are different, return a string explaining the first difference found. If identical, return None
+    """
+    columns1 = get_dataset_columns(file_name_1, dataset_name)
+    columns2 = get_dataset_columns(file_name_2, dataset_name)
+
+    column_names1 = sorted(columns1.keys())
+    column_names2 = sorted(columns2.keys())
+    if column_names1 != column_names2:
+        return f"Column names in '{dataset_name}' are different: {column_names1} != {column_names2}"
+
+    n_entries1 = len(columns1["eventNumber"])
+    n_entries2 = len(columns2["eventNumber"])
+    if n_entries1 != n_entries2:
+        return f"'{dataset_name}' has different number of entries: {n_entries1} != {n_entries2}"
+
+    dict_eventNumber_to_entry_2 = {int(event_number) : i for i, event_number in enumerate(columns2["eventNumber"])}
+    for i, event_number in enumerate(columns1["eventNumber"]):
+        if int(event_number) not in dict_eventNumber_to_entry_2:
+            return f"Event number {event_number} in '{dataset_name}' of file {file_name_1} is not found in file {file_name_2}"
+        entry2 = dict_eventNumber_to_entry_2[int(event_number)]
+        for column_name in column_names1:
+            val1 = columns1[column_name][i]
+            val2 = columns2[column_name][entry2]
+            if not values_are_equal(val1, val2):
+                return f"Column '{column_name}' in '{dataset_name}' has different values for entry {i}: {val1} != {val2}"
+    return None
+
 def compare_1d_histograms(hist1 : TH1D, hist2 : TH1D) -> str:
     """
     Compare two TH1D histograms. If they are different, return a string explaining the first difference found. If identical, return None
@@ -120,13 +175,13 @@ def get_list_of_objects_in_tdirectory(tdirectory : TDirectory, object_type : str
             objects.append(key.GetName())
     return objects
 
-def compare_histograms_in_folder(tfile1 : TFile, tfile2 : TFile, folder : str, histo_type : str = "TH1D"):
+def compare_histograms_in_folder(tfile1 : TFile, tfile2 : TFile, folder : str, histo_type : str = "TH1D", histograms_to_ignore : list[str] = []):
     """
-    Compare all histograms in a folder of two TFiles and return a string explaining the first difference found. If identical, return None
+    Compare all histograms, except for histograms_to_ignore, in a folder of two TFiles and return a string explaining the first difference found. If identical, return None
     """
     # Get the list of histograms in the folder
-    histograms1 = get_list_of_objects_in_tdirectory(tfile1.Get(folder), histo_type)
-    histograms2 = get_list_of_objects_in_tdirectory(tfile2.Get(folder), histo_type)
+    histograms1 = [name for name in get_list_of_objects_in_tdirectory(tfile1.Get(folder), histo_type) if name not in histograms_to_ignore]
+    histograms2 = [name for name in get_list_of_objects_in_tdirectory(tfile2.Get(folder), histo_type) if name not in histograms_to_ignore]
 
     # check if the files have the same histograms
     histograms1.sort()
@@ -156,16 +211,33 @@ def compare_histograms_in_folder(tfile1 : TFile, tfile2 : TFile, folder : str, h
             return f"Histograms {hist_name} in folder {folder} have different values: {result}"
     return None
 
-def compare_all_histograms_in_files(file1 : TFile, file2 : TFile, folders_to_ignore : list[str] = []) -> str:
+def compare_top_level_histograms(file1 : TFile, file2 : TFile, histograms_to_ignore : list[str] = []) -> str:
     """
-    Loop over all folders in the files and compare the histograms. If they are different, return a string explaining the first difference found. If identical, return None
+    Compare the histograms outside of the folders (e.g. cutflows and truth histograms) of two TFiles and return a string explaining the first difference found. If identical, return None
+    """
+    compare_functions = {"TH1D" : compare_1d_histograms, "TH2D" : compare_2d_histograms, "TH3D" : compare_3d_histograms}
+    for histo_type, compare_function in compare_functions.items():
+        histograms1 = sorted([name for name in get_list_of_objects_in_tdirectory(file1, histo_type) if name not in histograms_to_ignore])
+        histograms2 = sorted([name for name in get_list_of_objects_in_tdirectory(file2, histo_type) if name not in histograms_to_ignore])
+        if histograms1 != histograms2:
+            return f"Histograms outside of the folders are different: {histograms1} != {histograms2}"
+
+        for hist_name in histograms1:
+            result = compare_function(file1.Get(hist_name), file2.Get(hist_name))
+            if result:
+                return f"Histograms {hist_name} have different values: {result}"
+    return None
+
+def compare_all_histograms_in_files(file1 : TFile, file2 : TFile, objects_to_ignore : list[str] = []) -> str:
+    """
+    Loop over all folders, except for objects_to_ignore, in the files and compare the histograms, except for objects_to_ignore. If they are different, return a string explaining the first difference found. If identical, return None
     """
     # Get the list of folders in each file
     folders1 = get_list_of_folders(file1)
     folders2 = get_list_of_folders(file2)
 
-    # remove ignored folders
-    for folder in folders_to_ignore:
+    # remove ignored folders, the ignored histograms are removed in each folder
+    for folder in objects_to_ignore:
         if folder in folders1:
             folders1.remove(folder)
         if folder in folders2:
@@ -179,13 +251,13 @@ def compare_all_histograms_in_files(file1 : TFile, file2 : TFile, folders_to_ign
 
     # Loop over all folders and compare the histograms
     for folder in folders1:
-        comparison_1D = compare_histograms_in_folder(file1, file2, folder, "TH1D")
+        comparison_1D = compare_histograms_in_folder(file1, file2, folder, "TH1D", objects_to_ignore)
         if comparison_1D:
             return comparison_1D
-        comparison_2D = compare_histograms_in_folder(file1, file2, folder, "TH2D")
+        comparison_2D = compare_histograms_in_folder(file1, file2, folder, "TH2D", objects_to_ignore)
         if comparison_2D:
             return comparison_2D
-        comparison_3D = compare_histograms_in_folder(file1, file2, folder, "TH3D")
+        comparison_3D = compare_histograms_in_folder(file1, file2, folder, "TH3D", objects_to_ignore)
         if comparison_3D:
             return comparison_3D
 
@@ -207,22 +279,27 @@ def compare_all_trees_in_files(file1 : TFile, file2 : TFile, trees_to_ignore : l
         if tree in trees2:
             trees2.remove(tree)
 
+    # the RNTuples are compared to the trees or RNTuples with the same name
+    rntuples1 = [name for class_name in RNTUPLE_CLASS_NAMES for name in get_list_of_objects_in_tdirectory(file1, class_name) if name not in trees_to_ignore]
+    rntuples2 = [name for class_name in RNTUPLE_CLASS_NAMES for name in get_list_of_objects_in_tdirectory(file2, class_name) if name not in trees_to_ignore]
+
     # check if the files have the same trees
-    trees1.sort()
-    trees2.sort()
-    if trees1 != trees2:
-        return f"Trees in file {file1} are different: {trees1} != {trees2}"
+    datasets1 = sorted(trees1 + rntuples1)
+    datasets2 = sorted(trees2 + rntuples2)
+    if datasets1 != datasets2:
+        return f"Trees in file {file1} are different: {datasets1} != {datasets2}"
 
     # Loop over all trees and compare them
-    for tree_name in trees1:
-        tree1 = file1.Get(tree_name)
-        tree2 = file2.Get(tree_name)
-        result = test_compare_trees(tree1, tree2)
+    for tree_name in datasets1:
+        if tree_name in rntuples1 or tree_name in rntuples2:
+            result = test_compare_datasets(file1.GetName(), file2.GetName(), tree_name)
+        else:
+            result = test_compare_trees(file1.Get(tree_name), file2.Get(tree_name))
         if result:
             return result
     return None
 
-def test_compare_files(file1 : str, file2 : str) -> str:
+def test_compare_files(file1 : str, file2 : str, objects_to_ignore : list[str] = []) -> str:
     """
     Compare two ROOT files, if they are not identical, return a string explaining the first difference found. If identical, return None
     """
@@ -235,10 +312,15 @@ def test_compare_files(file1 : str, file2 : str) -> str:
         return f"File {file2} could not be opened"
 
     # Compare all histograms in the files
-    comparison_histograms = compare_all_histograms_in_files(tfile1, tfile2, [])
+    comparison_histograms = compare_all_histograms_in_files(tfile1, tfile2, objects_to_ignore)
     if comparison_histograms:
         return comparison_histograms
 
+    # Compare the histograms outside of the folders, e.g. the cutflows
+    comparison_top_level = compare_top_level_histograms(tfile1, tfile2, objects_to_ignore)
+    if comparison_top_level:
+        return comparison_top_level
+
     # Compare all trees in the files
     comparison_trees = compare_all_trees_in_files(tfile1, tfile2, [])
     if comparison_trees:
@@ -252,11 +334,11 @@ def test_compare_files(file1 : str, file2 : str) -> str:
 
 
 if __name__ == "__main__":
-    if len(sys.argv) != 3:
-        print("Usage: python test_compare_trees.py <file1> <file2>")
+    if len(sys.argv) < 3:
+        print("Usage: python test_compare_trees.py <file1> <file2> [<ignored object> ...]")
         sys.exit(1)
 
-    comparison_result = test_compare_files(sys.argv[1], sys.argv[2])
+    comparison_result = test_compare_files(sys.argv[1], sys.argv[2], sys.argv[3:])
     if comparison_result:
         print(comparison_result)
         sys.exit(1)